@@ -0,0 +1,357 @@
+// Benchmark of the sampling engines against std::discrete_distribution.
+//
+// Usage: fast_discrete_distribution_benchmark [num_samples] [large_n]
+//
+// For every combination of support size and weight shape the program reports
+// the construction time and the time per sample of every engine, and the time
+// per sample of the bulk generate() path using the kernel variant selected at
+// run time.
+//
+// If large_n is given, the program also builds a table with large_n outcomes
+// and 64-bit ids, e.g. 10000000000 on a machine with about 512 GB of memory
+// (the build needs about 40 bytes per outcome).
+
+#include "auto_discrete_distribution.hpp"
+#include "blocked_discrete_distribution.hpp"
+#include "compact_discrete_distribution.hpp"
+#include "concurrent_discrete_distribution.hpp"
+#include "dynamic_discrete_distribution.hpp"
+#include "fast_discrete_distribution.hpp"
+#include "float_discrete_distribution.hpp"
+#include "guide_table_discrete_distribution.hpp"
+#include "knuth_yao_discrete_distribution.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "workloads.hpp"
+
+namespace {
+
+// Returns the number of nanoseconds per sample.  The sum of the samples is
+// accumulated into the checksum so that the loop is not optimized away.
+template<typename Distribution>
+double TimeSampling(Distribution& distribution, const size_t num_samples,
+                    unsigned long long* checksum) {
+  std::default_random_engine generator(1);
+  unsigned long long sum = 0;
+  const Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < num_samples; ++i) sum += distribution(generator);
+  const double seconds = SecondsSince(start);
+  *checksum += sum;
+  return seconds * 1e9 / num_samples;
+}
+
+// Same as TimeSampling but draws the samples with generate() in blocks.
+template<typename Distribution>
+double TimeBulkSampling(Distribution& distribution, const size_t num_samples,
+                        unsigned long long* checksum) {
+  std::default_random_engine generator(1);
+  std::vector<typename Distribution::result_type> block(4096);
+  unsigned long long sum = 0;
+  const Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < num_samples; i += block.size()) {
+    const size_t n = std::min(block.size(), num_samples - i);
+    distribution.generate(generator, block.data(), block.data() + n);
+    for (size_t j = 0; j < n; ++j) sum += block[j];
+  }
+  const double seconds = SecondsSince(start);
+  *checksum += sum;
+  return seconds * 1e9 / num_samples;
+}
+
+// Builds the distribution from the weights and prints one row with the
+// construction time and the time per sample.
+template<typename Distribution>
+void Run(const char* engine, const char* shape,
+         const std::vector<double>& weights, const size_t num_samples,
+         unsigned long long* checksum) {
+  const Clock::time_point start = Clock::now();
+  Distribution distribution(weights);
+  const double build = SecondsSince(start);
+  const double sample = TimeSampling(distribution, num_samples, checksum);
+  std::printf("%-10s %10zu %-14s %12.3f %10.2f\n", shape, weights.size(),
+              engine, build * 1e3, sample);
+}
+
+// Like Run() for knuth_yao_discrete_distribution.  Also prints the number of
+// random bits consumed per sample and the entropy of the distribution.
+void RunKnuthYao(const char* shape, const std::vector<double>& weights,
+                 const size_t num_samples, unsigned long long* checksum) {
+  const Clock::time_point start = Clock::now();
+  knuth_yao_discrete_distribution<int> distribution(weights);
+  const double build = SecondsSince(start);
+  const double sample = TimeSampling(distribution, num_samples, checksum);
+
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  double entropy = 0.0;
+  for (auto weight : weights) {
+    if (weight > 0.0) entropy -= weight / sum * std::log2(weight / sum);
+  }
+  const double bits =
+    static_cast<double>(distribution.bits_consumed()) / num_samples;
+  std::printf("%-10s %10zu %-14s %12.3f %10.2f   %.2f bits/sample,"
+              " entropy %.2f\n", shape, weights.size(), "knuth-yao",
+              build * 1e3, sample, bits, entropy);
+}
+
+// std::discrete_distribution has no constructor from a vector.
+class std_distribution : public std::discrete_distribution<int> {
+  public:
+    std_distribution(const std::vector<double>& weights)
+      : std::discrete_distribution<int>(weights.begin(), weights.end()) { }
+};
+
+// auto_discrete_distribution restricted to one engine.
+template<discrete_engine kEngine>
+class forced_engine_distribution : public auto_discrete_distribution<int> {
+  public:
+    forced_engine_distribution(const std::vector<double>& weights)
+      : auto_discrete_distribution<int>(weights, kEngine) { }
+};
+
+// Like Run() for fast_discrete_distribution with a fixed support size N.
+template<size_t N>
+void RunFixed(const char* shape, const std::vector<double>& weights,
+              const size_t num_samples, unsigned long long* checksum) {
+  if (weights.size() != N) return;
+  std::array<double, N> fixed_weights;
+  std::copy(weights.begin(), weights.end(), fixed_weights.begin());
+  const Clock::time_point start = Clock::now();
+  fast_discrete_distribution<int, N> distribution(fixed_weights);
+  const double build = SecondsSince(start);
+  const double sample = TimeSampling(distribution, num_samples, checksum);
+  std::printf("%-10s %10zu %-14s %12.3f %10.2f\n", shape, N, "alias fixed",
+              build * 1e3, sample);
+}
+
+// Baseline for concurrent_discrete_distribution: a table behind a mutex.
+class locked_distribution {
+  public:
+    typedef int result_type;
+    typedef fast_discrete_distribution<int>::param_type param_type;
+
+    explicit locked_distribution(param_type param)
+      : table_(std::move(param)) { }
+
+    template<typename URNG>
+    int operator()(URNG& generator) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return table_(generator, table_.param());
+    }
+
+    void update(param_type param) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      table_.param(std::move(param));
+    }
+
+  private:
+    fast_discrete_distribution<int> table_;
+    std::mutex mutex_;
+};
+
+// num_readers threads draw num_samples samples in total from one shared
+// distribution while a writer republishes a table of the same size every
+// millisecond.  Prints the wall-clock time per sample.
+template<typename Distribution>
+void RunReaders(const char* engine, const std::vector<double>& weights,
+                const size_t num_readers, const size_t num_samples,
+                unsigned long long* checksum) {
+  Distribution distribution(weights);
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    while (!done.load()) {
+      distribution.update(weights);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  std::vector<unsigned long long> sums(num_readers, 0);
+  std::vector<std::thread> readers;
+  const Clock::time_point start = Clock::now();
+  for (size_t t = 0; t < num_readers; ++t) {
+    readers.emplace_back([&, t]() {
+      std::default_random_engine generator(static_cast<unsigned>(t + 1));
+      unsigned long long sum = 0;
+      for (size_t i = 0; i < num_samples / num_readers; ++i)
+        sum += distribution(generator);
+      sums[t] = sum;
+    });
+  }
+  for (auto& reader : readers) reader.join();
+  const double seconds = SecondsSince(start);
+  done.store(true);
+  writer.join();
+
+  for (auto sum : sums) *checksum += sum;
+  const std::string name = engine + std::string(" x") +
+                           std::to_string(num_readers);
+  std::printf("%-10s %10zu %-14s %12s %10.2f\n", "random", weights.size(),
+              name.c_str(), "", seconds * 1e9 / num_samples);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+  const size_t large_n = argc > 2 ? std::stoull(argv[2]) : 0;
+  unsigned long long checksum = 0;
+  std::printf("kernel variant: %s\n", kernel_isa_name(active_kernel_isa()));
+  std::printf("%-10s %10s %-14s %12s %10s\n", "shape", "N", "engine",
+              "build ms", "ns/op");
+  for (const size_t N : kSizes) {
+    for (const char* shape : kShapes) {
+      const std::vector<double> weights = MakeWeights(shape, N);
+
+      Run<fast_discrete_distribution<int>>("alias", shape, weights,
+                                           num_samples, &checksum);
+
+      fast_discrete_distribution<int> fast(weights);
+      const double bulk = TimeBulkSampling(fast, num_samples, &checksum);
+      std::printf("%-10s %10zu %-14s %12s %10.2f\n", shape, N, "alias bulk",
+                  "", bulk);
+
+      Run<float_discrete_distribution<int>>("alias float", shape, weights,
+                                            num_samples, &checksum);
+      float_discrete_distribution<int> single(weights);
+      const double single_bulk =
+        TimeBulkSampling(single, num_samples, &checksum);
+      std::printf("%-10s %10zu %-14s %12s %10.2f\n", shape, N,
+                  "float bulk", "", single_bulk);
+
+      Run<blocked_discrete_distribution<int>>("blocked", shape, weights,
+                                              num_samples, &checksum);
+      blocked_discrete_distribution<int> blocked(weights);
+      const double blocked_bulk =
+        TimeBulkSampling(blocked, num_samples, &checksum);
+      std::printf("%-10s %10zu %-14s %12s %10.2f\n", shape, N,
+                  "blocked bulk", "", blocked_bulk);
+
+      if (N <= compact_discrete_distribution<int>::kMaxSupport)
+        Run<compact_discrete_distribution<int>>("alias compact", shape,
+                                                weights, num_samples,
+                                                &checksum);
+      Run<concurrent_discrete_distribution<int>>("concurrent", shape,
+                                                 weights, num_samples,
+                                                 &checksum);
+      Run<dynamic_discrete_distribution<int>>("dynamic", shape, weights,
+                                              num_samples, &checksum);
+      Run<guide_table_discrete_distribution<int>>("guide table", shape,
+                                                  weights, num_samples,
+                                                  &checksum);
+      // The tree needs O(N log N) memory; skip the largest tables.
+      if (N <= 100000)
+        RunKnuthYao(shape, weights, num_samples, &checksum);
+      Run<std_distribution>("std", shape, weights, num_samples, &checksum);
+    }
+  }
+
+  // Small supports, where auto_discrete_distribution switches engines.
+  const size_t small_sizes[] = {2, 4, 8, 16, 32, 64, 256};
+  for (const size_t N : small_sizes) {
+    for (const char* shape : kShapes) {
+      const std::vector<double> weights = MakeWeights(shape, N);
+      Run<forced_engine_distribution<discrete_engine::linear_scan>>(
+        "linear scan", shape, weights, num_samples, &checksum);
+      Run<forced_engine_distribution<discrete_engine::binary_search>>(
+        "binary search", shape, weights, num_samples, &checksum);
+      Run<forced_engine_distribution<discrete_engine::alias_table>>(
+        "alias", shape, weights, num_samples, &checksum);
+      Run<auto_discrete_distribution<int>>("auto", shape, weights,
+                                           num_samples, &checksum);
+      RunFixed<2>(shape, weights, num_samples, &checksum);
+      RunFixed<4>(shape, weights, num_samples, &checksum);
+      RunFixed<8>(shape, weights, num_samples, &checksum);
+      RunFixed<16>(shape, weights, num_samples, &checksum);
+    }
+  }
+  // 16-byte against 4-byte buckets on tables that fit into the L2 cache only
+  // with the smaller buckets.
+  const size_t compact_sizes[] = {16384, 65536};
+  for (const size_t N : compact_sizes) {
+    const std::vector<double> weights = MakeWeights("random", N);
+    Run<fast_discrete_distribution<int>>("alias", "random", weights,
+                                         num_samples, &checksum);
+    Run<compact_discrete_distribution<int>>("alias compact", "random",
+                                            weights, num_samples, &checksum);
+  }
+
+  // Changing 0.1% of the weights of dynamic_discrete_distribution against
+  // rebuilding the table.
+  {
+    const size_t N = 1000000;
+    const size_t num_changes = N / 1000;
+    const size_t num_rounds = 100;
+    const std::vector<double> weights = MakeWeights("random", N);
+    dynamic_discrete_distribution<int> dynamic(weights);
+    std::default_random_engine generator(7);
+    std::uniform_int_distribution<size_t> outcome(0, N - 1);
+    std::exponential_distribution<double> exponential(1.0);
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < num_rounds; ++round) {
+      for (size_t j = 0; j < num_changes; ++j)
+        dynamic.set_weight(outcome(generator), exponential(generator));
+    }
+    const double update = SecondsSince(start) / num_rounds;
+    start = Clock::now();
+    dynamic.rebuild();
+    const double rebuild = SecondsSince(start);
+    std::printf("%-10s %10zu %-14s %12.3f\n", "random", N, "dynamic 0.1%",
+                update * 1e3);
+    std::printf("%-10s %10zu %-14s %12.3f\n", "random", N, "dynamic full",
+                rebuild * 1e3);
+  }
+
+  // Reader scaling of concurrent_discrete_distribution against a mutex, with
+  // a writer republishing the table in the background.
+  {
+    const std::vector<double> weights = MakeWeights("random", 1000);
+    const size_t reader_counts[] = {1, 2, 4, 8};
+    for (const size_t num_readers : reader_counts) {
+      RunReaders<concurrent_discrete_distribution<int>>(
+        "epoch", weights, num_readers, num_samples, &checksum);
+      RunReaders<locked_distribution>("mutex", weights, num_readers,
+                                      num_samples, &checksum);
+    }
+  }
+
+  // Prefetch distance of generate() on tables larger than the cache.
+  const size_t large_sizes[] = {kSizes[3], 4 * kSizes[3]};
+  const size_t distances[] = {0, 8, 16, 32, 64, 128, 256, 512, 1024};
+  for (const size_t N : large_sizes) {
+    fast_discrete_distribution<int> fast(MakeWeights("random", N));
+    for (const size_t distance : distances) {
+      fast.set_prefetch_distance(distance);
+      const double bulk = TimeBulkSampling(fast, num_samples, &checksum);
+      const std::string engine = "bulk d=" + std::to_string(distance);
+      std::printf("%-10s %10zu %-14s %12s %10.2f\n", "random", N,
+                  engine.c_str(), "", bulk);
+    }
+  }
+
+  if (large_n > 0) {
+    // The weights are computed on the fly, so the only copies are the
+    // probabilities and the table.
+    Clock::time_point start = Clock::now();
+    fast_discrete_distribution<int64_t> large(
+      large_n, 0.0, 1.0, [](double x) { return 1.0 + std::sin(1e6 * x); });
+    const double build = SecondsSince(start);
+    const double sample = TimeSampling(large, num_samples, &checksum);
+    std::printf("%-10s %10zu %-14s %12.3f %10.2f\n", "sine", large_n,
+                "alias 64-bit", build * 1e3, sample);
+  }
+
+  std::printf("checksum %llu\n", checksum);
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Training workload for profile-guided optimization.
+//
+// Usage: fast_discrete_distribution_pgo_training [num_samples]
+//
+// Constructs and samples from distributions of all sizes and weight shapes
+// used by the benchmark.  The program is run once by the instrumented build to
+// collect profiles and then by the baseline and optimized builds to measure
+// the speedup.  The last line of the output is the total running time.
+
+#include "fast_discrete_distribution.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "workloads.hpp"
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(2000000);
+
+  unsigned long long checksum = 0;
+  double total_seconds = 0.0;
+  for (const size_t N : kSizes) {
+    for (const char* shape : kShapes) {
+      const std::vector<double> weights = MakeWeights(shape, N);
+      std::default_random_engine generator(1);
+
+      const Clock::time_point start = Clock::now();
+      fast_discrete_distribution<int> distribution(weights);
+      for (size_t i = 0; i < num_samples; ++i)
+        checksum += distribution(generator);
+      total_seconds += SecondsSince(start);
+    }
+  }
+  std::printf("checksum %llu\n", checksum);
+  std::printf("total_seconds %.6f\n", total_seconds);
+  return 0;
+}
@@ -0,0 +1,100 @@
+// Benchmark of distribution_pool against one fast_discrete_distribution per
+// node, on a random graph.
+//
+// Usage: distribution_pool_benchmark [num_nodes] [num_samples]
+
+#include "distribution_pool.hpp"
+#include "fast_discrete_distribution.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "workloads.hpp"
+
+int main(int argc, char* argv[]) {
+  const size_t num_nodes =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(1000000);
+  const size_t num_samples =
+    argc > 2 ? std::stoull(argv[2]) : static_cast<size_t>(10000000);
+
+  // CSR weights of a graph with random degrees between 1 and 20.
+  std::default_random_engine generator(17);
+  std::exponential_distribution<double> exponential(1.0);
+  std::uniform_int_distribution<size_t> degree(1, 20);
+  std::vector<size_t> offsets(1, 0);
+  std::vector<double> weights;
+  for (size_t v = 0; v < num_nodes; ++v) {
+    const size_t n = degree(generator);
+    for (size_t k = 0; k < n; ++k) weights.push_back(exponential(generator));
+    offsets.push_back(weights.size());
+  }
+  std::printf("nodes %zu, edges %zu\n", num_nodes, weights.size());
+
+  unsigned long long checksum = 0;
+  std::uniform_int_distribution<size_t> node(0, num_nodes - 1);
+
+  {
+    Clock::time_point start = Clock::now();
+    std::vector<fast_discrete_distribution<int>> distributions;
+    distributions.reserve(num_nodes);
+    for (size_t v = 0; v < num_nodes; ++v) {
+      distributions.emplace_back(std::vector<double>(
+        weights.begin() + offsets[v], weights.begin() + offsets[v + 1]));
+    }
+    const double build = SecondsSince(start);
+
+    std::default_random_engine sample_generator(1);
+    start = Clock::now();
+    for (size_t i = 0; i < num_samples; ++i)
+      checksum += distributions[node(sample_generator)](sample_generator);
+    const double sample = SecondsSince(start);
+    std::printf("%-28s build %8.1f ms, %6.2f ns/sample\n",
+                "per-node distributions", build * 1e3,
+                sample * 1e9 / num_samples);
+  }
+
+  std::vector<size_t> thread_counts(1, 1);
+  if (std::thread::hardware_concurrency() > 1)
+    thread_counts.push_back(std::thread::hardware_concurrency());
+  for (const size_t threads : thread_counts) {
+    Clock::time_point start = Clock::now();
+    distribution_pool<int> pool(offsets, weights, threads);
+    const double build = SecondsSince(start);
+
+    std::default_random_engine sample_generator(1);
+    start = Clock::now();
+    for (size_t i = 0; i < num_samples; ++i)
+      checksum += pool.sample(node(sample_generator), sample_generator);
+    double sample = SecondsSince(start);
+    const std::string name =
+      "pool (" + std::to_string(threads) + " build threads)";
+    std::printf("%-28s build %8.1f ms, %6.2f ns/sample\n", name.c_str(),
+                build * 1e3, sample * 1e9 / num_samples);
+
+    if (threads != 1) continue;
+
+    // The same samples drawn with sample_many(), in batches of 1024 nodes.
+    // Drawing the node ids is timed as well, as above.
+    const size_t batch_size = 1024;
+    std::vector<size_t> ids(batch_size);
+    std::vector<int> outcomes(batch_size);
+    start = Clock::now();
+    for (size_t i = 0; i < num_samples; i += batch_size) {
+      const size_t n = std::min(batch_size, num_samples - i);
+      for (size_t j = 0; j < n; ++j) ids[j] = node(sample_generator);
+      pool.sample_many(ids.data(), ids.data() + n, sample_generator,
+                       outcomes.data());
+      for (size_t j = 0; j < n; ++j) checksum += outcomes[j];
+    }
+    sample = SecondsSince(start);
+    std::printf("%-28s %20s %6.2f ns/sample\n", "pool sample_many", "",
+                sample * 1e9 / num_samples);
+  }
+
+  std::printf("checksum %llu\n", checksum);
+  return 0;
+}
@@ -0,0 +1,41 @@
+// Workloads shared by the benchmark and the PGO training program.
+
+#ifndef BENCHMARKS_WORKLOADS_HPP_
+#define BENCHMARKS_WORKLOADS_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+inline double SecondsSince(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Support sizes and weight shapes covered by the workloads.
+static const size_t kSizes[] = {10, 1000, 100000, 10000000};
+static const char* const kShapes[] = {"uniform", "random", "zipf", "geometric"};
+
+// Weight vectors of various shapes.
+inline std::vector<double> MakeWeights(const std::string& shape, const size_t N) {
+  std::vector<double> weights(N);
+  std::default_random_engine generator(12345);
+  std::exponential_distribution<double> exponential(1.0);
+  for (size_t i = 0; i < N; ++i) {
+    if (shape == "uniform") {
+      weights[i] = 1.0;
+    } else if (shape == "random") {
+      weights[i] = exponential(generator);
+    } else if (shape == "zipf") {
+      weights[i] = 1.0 / (i + 1);
+    } else {  // "geometric"
+      weights[i] = std::pow(0.9, static_cast<double>(i % 1000));
+    }
+  }
+  return weights;
+}
+
+#endif  // BENCHMARKS_WORKLOADS_HPP_
@@ -0,0 +1,96 @@
+# Builds the project with profile-guided optimization and reports the speedup.
+#
+# Invoked by the "pgo" target as
+#
+#   cmake -DSOURCE_DIR=... -DBINARY_DIR=... -DCXX_COMPILER=...
+#         -DCOMPILER_ID=... -DGENERATOR=... -DSAMPLES=... -P pgo.cmake
+#
+# Steps:
+#   1. Build the training workload without PGO (baseline).
+#   2. Build the training workload and the benchmark with instrumentation and
+#      run both to collect profiles.
+#   3. Rebuild everything in the same directory using the profiles.  GCC names
+#      profile files after object paths, so the instrumented and optimized
+#      builds must share a directory.
+#   4. Run the baseline and optimized workloads and print the speedup.
+
+set(training fast_discrete_distribution_pgo_training)
+set(benchmark fast_discrete_distribution_benchmark)
+set(baseline_dir "${BINARY_DIR}/pgo/baseline")
+set(optimized_dir "${BINARY_DIR}/pgo/optimized")
+set(profile_dir "${BINARY_DIR}/pgo/profiles")
+
+function(run)
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Command failed: ${ARGN}")
+  endif()
+endfunction()
+
+# Configures the build in dir.  -S and -B need CMake 3.13, so the source
+# directory is passed as the argument and dir is the working directory.
+function(configure dir pgo)
+  file(MAKE_DIRECTORY "${dir}")
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} "${SOURCE_DIR}" -G "${GENERATOR}"
+            -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+            -DFDD_PGO=${pgo} -DFDD_PGO_DIR=${profile_dir}
+    WORKING_DIRECTORY "${dir}"
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Configuring ${dir} failed")
+  endif()
+endfunction()
+
+# Runs the training workload and stores its total running time in var.
+function(time_workload dir var)
+  execute_process(COMMAND "${dir}/${training}" ${SAMPLES}
+                  OUTPUT_VARIABLE output RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Training workload failed in ${dir}")
+  endif()
+  # The time is printed with six decimals; read it as integer microseconds.
+  string(REGEX MATCH "total_seconds ([0-9]+)\\.([0-9]+)" match "${output}")
+  math(EXPR microseconds "${CMAKE_MATCH_1} * 1000000 + ${CMAKE_MATCH_2}")
+  set(${var} ${microseconds} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "PGO: building baseline")
+configure("${baseline_dir}" OFF)
+run(${CMAKE_COMMAND} --build "${baseline_dir}" --target ${training})
+
+message(STATUS "PGO: collecting profiles")
+file(REMOVE_RECURSE "${profile_dir}")
+configure("${optimized_dir}" GENERATE)
+run(${CMAKE_COMMAND} --build "${optimized_dir}" --target ${training}
+    ${benchmark})
+run("${optimized_dir}/${training}" ${SAMPLES})
+run("${optimized_dir}/${benchmark}" ${SAMPLES})
+
+if(COMPILER_ID MATCHES "Clang")
+  # find_program(... REQUIRED) needs CMake 3.18.
+  find_program(LLVM_PROFDATA NAMES llvm-profdata)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata not found; it is needed to merge "
+                        "Clang profiles")
+  endif()
+  file(GLOB raw_profiles "${profile_dir}/*.profraw")
+  run(${LLVM_PROFDATA} merge -output=${profile_dir}/default.profdata
+      ${raw_profiles})
+endif()
+
+message(STATUS "PGO: building with profiles")
+configure("${optimized_dir}" USE)
+run(${CMAKE_COMMAND} --build "${optimized_dir}")
+
+time_workload("${baseline_dir}" baseline_us)
+time_workload("${optimized_dir}" optimized_us)
+math(EXPR speedup "${baseline_us} * 100 / ${optimized_us}")
+math(EXPR speedup_whole "${speedup} / 100")
+math(EXPR speedup_fraction "${speedup} % 100")
+if(speedup_fraction LESS 10)
+  set(speedup_fraction "0${speedup_fraction}")
+endif()
+message(STATUS "PGO: baseline ${baseline_us} us, optimized ${optimized_us} us, "
+               "speedup ${speedup_whole}.${speedup_fraction}x")
+message(STATUS "PGO: optimized binaries are in ${optimized_dir}")
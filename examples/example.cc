@@ -0,0 +1,19 @@
+// Example: roll a loaded die.
+
+#include "fast_discrete_distribution.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main() {
+  std::default_random_engine generator;
+  fast_discrete_distribution<int> die({1, 1, 1, 1, 1, 5});
+
+  std::vector<int> counts(6, 0);
+  for (int i = 0; i < 10000; ++i) ++counts[die(generator)];
+
+  for (int face = 0; face < 6; ++face)
+    std::cout << face + 1 << ": " << counts[face] << std::endl;
+  return 0;
+}
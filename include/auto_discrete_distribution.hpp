@@ -0,0 +1,202 @@
+// Discrete distribution that picks the fastest sampling engine for its size
+// and shape.
+//
+// For very small distributions a branchless linear scan over the cumulative
+// distribution function is faster than the alias table, because it needs no
+// random index into a table and no branch on the threshold of a bucket.  The
+// exception is equal weights: their alias table has only pure buckets, so its
+// branch is always predicted and the table wins at every size.  Otherwise
+// the alias table of fast_discrete_distribution wins.  Mass concentrated on
+// the first outcomes does not help the scan beyond 16 outcomes: skewed
+// weights also make most buckets of the alias table go the same way.  A branchless binary search over the
+// cumulative distribution is available as well, but on the machines we
+// measured it was never faster than the alias table: it makes log N dependent
+// loads where the alias table makes one.  It is therefore only used when
+// requested explicitly.  The threshold was measured with the benchmark, which
+// prints one row per engine (see README.md).
+
+#ifndef AUTO_DISCRETE_DISTRIBUTION_HPP_
+#define AUTO_DISCRETE_DISTRIBUTION_HPP_
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "fast_discrete_distribution.hpp"
+
+enum class discrete_engine { linear_scan, binary_search, alias_table };
+
+inline const char* discrete_engine_name(const discrete_engine engine) {
+  switch (engine) {
+    case discrete_engine::linear_scan: return "linear scan";
+    case discrete_engine::binary_search: return "binary search";
+    default: return "alias table";
+  }
+}
+
+template<typename IntType = int>
+class auto_discrete_distribution {
+  public:
+    typedef IntType result_type;
+
+    // Largest support size for which the linear scan is used.  Measured on
+    // x86-64: at 16 outcomes the scan and the alias table take about the same
+    // time per sample.
+    static const size_t kMaxLinearScan = 16;
+
+    auto_discrete_distribution(const std::vector<double>& weights)
+      : auto_discrete_distribution(weights, choose_engine(weights)) { }
+
+    // Uses the given engine regardless of the weights.  Only the alias
+    // table engine builds an alias table.
+    auto_discrete_distribution(const std::vector<double>& weights,
+                               const discrete_engine engine)
+      : engine_(engine), uniform_distribution_(0.0, 1.0) {
+      if (engine_ == discrete_engine::alias_table) {
+        alias_.reset(new fast_discrete_distribution<IntType>(weights));
+        probabilities_ = alias_->probabilities();
+      } else {
+        normalize_weights(weights);
+        create_cdf();
+      }
+    }
+
+    auto_discrete_distribution(const auto_discrete_distribution& other)
+      : engine_(other.engine_),
+        uniform_distribution_(other.uniform_distribution_),
+        probabilities_(other.probabilities_),
+        cdf_(other.cdf_),
+        alias_(other.alias_
+               ? new fast_discrete_distribution<IntType>(*other.alias_)
+               : nullptr) { }
+
+    auto_discrete_distribution(auto_discrete_distribution&& other) = default;
+
+    auto_discrete_distribution& operator=(auto_discrete_distribution other) {
+      std::swap(engine_, other.engine_);
+      std::swap(uniform_distribution_, other.uniform_distribution_);
+      probabilities_.swap(other.probabilities_);
+      cdf_.swap(other.cdf_);
+      alias_.swap(other.alias_);
+      return *this;
+    }
+
+    // Chooses the engine from the number of outcomes and the shape of the
+    // weights.  The linear scan looks at every outcome, including outcomes
+    // with zero weight, so the choice counts all of them.
+    static discrete_engine choose_engine(const std::vector<double>& weights) {
+      const bool equal =
+        weights.size() >= 2
+        && std::all_of(weights.begin(), weights.end(),
+                       [&](const double weight) {
+                         return weight == weights.front();
+                       });
+      if (weights.size() <= kMaxLinearScan && !equal)
+        return discrete_engine::linear_scan;
+      return discrete_engine::alias_table;
+    }
+
+    result_type operator()(std::default_random_engine& generator) {
+      switch (engine_) {
+        case discrete_engine::linear_scan:
+          return linear_scan(uniform_distribution_(generator));
+        case discrete_engine::binary_search:
+          return binary_search(uniform_distribution_(generator));
+        default:
+          return (*alias_)(generator);
+      }
+    }
+
+    // The engine used for sampling.
+    discrete_engine engine() const {
+      return engine_;
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(probabilities_.size() - 1);
+    }
+
+    std::vector<double> probabilities() const {
+      return probabilities_;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+  private:
+    // Counts the cumulative probabilities not exceeding u without branches.
+    result_type linear_scan(const double u) const {
+      size_t index = 0;
+      for (size_t i = 0; i + 1 < cdf_.size(); ++i) index += cdf_[i] <= u;
+      return static_cast<result_type>(index);
+    }
+
+    // Finds the first cumulative probability exceeding u with a binary
+    // search that compiles to conditional moves instead of branches.
+    result_type binary_search(const double u) const {
+      if (cdf_.empty()) return static_cast<result_type>(0);
+      size_t first = 0;
+      size_t count = cdf_.size() - 1;
+      while (count > 0) {
+        const size_t step = count / 2;
+        const bool right = cdf_[first + step] <= u;
+        first = right ? first + step + 1 : first;
+        count = right ? count - step - 1 : step;
+      }
+      return static_cast<result_type>(first);
+    }
+
+    void normalize_weights(const std::vector<double>& weights) {
+      const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+      probabilities_.reserve(weights.size());
+      for (auto weight : weights) {
+        probabilities_.push_back(weight / sum);
+      }
+    }
+
+    void create_cdf() {
+      const size_t N = probabilities_.size();
+      if (N == 0) return;
+
+      cdf_.resize(N);
+      double sum = 0.0;
+      for (size_t i = 0; i < N; ++i) {
+        sum += probabilities_[i];
+        cdf_[i] = sum;
+      }
+
+      // Make the cumulative probability exactly 1 from the last outcome with
+      // positive probability onwards, so that trailing zero-probability
+      // outcomes are never generated.
+      size_t last_positive = N - 1;
+      while (last_positive > 0 && !(probabilities_[last_positive] > 0.0))
+        --last_positive;
+      for (size_t i = last_positive; i < N; ++i) cdf_[i] = 1.0;
+    }
+
+    discrete_engine engine_;
+
+    // Uniform distribution over interval [0,1].
+    std::uniform_real_distribution<double> uniform_distribution_;
+
+    // List of probabilities
+    std::vector<double> probabilities_;
+
+    // Cumulative distribution function used by the linear scan and the binary
+    // search.
+    std::vector<double> cdf_;
+
+    // Used by the alias table engine; null otherwise.
+    std::unique_ptr<fast_discrete_distribution<IntType>> alias_;
+};
+
+#endif  // AUTO_DISCRETE_DISTRIBUTION_HPP_
@@ -0,0 +1,361 @@
+// Discrete distribution stored as a two-level table.
+//
+// The outcomes are split into blocks of block_size consecutive outcomes.  A
+// top-level alias table over the blocks, with the total weight of a block as
+// its weight, picks a block, and the alias table of the block picks an
+// outcome inside it.  The block tables are stored one after another, and with
+// the default block size a block fills exactly one 4 KiB page and starts at a
+// page boundary.  A sample touches the top table, which has N / 256 buckets
+// and stays in the cache for N up to about 10^8, and one page of block
+// tables.
+//
+// Both levels use Vose's layout with thresholds relative to the bucket (see
+// detail::vose_bucket); the aliases of a block table are local to the block.
+// A block table depends only on the weights of its block, so blocks can be
+// built, stored and loaded independently of each other; only the small top
+// table needs all block weights.
+//
+// A sample draws a single uniform number.  The top table maps it to a block
+// and to the position of the number inside the segment of the block, which
+// is again uniform in [0,1) and picks the outcome inside the block.  The
+// position is computed in double precision from a number with 53 bits, so
+// every top-level segment can move a few 2^-53 of probability between the
+// outcomes of its block; verify() computes the table as if it were exact.
+// While the whole table is in memory, the extra lookup in the top table makes
+// sampling slower than with fast_discrete_distribution: on random weights with
+// N = 10^7, operator() takes 152 instead of 105 ns and generate() 65 instead
+// of 30 ns per sample.
+
+#ifndef BLOCKED_DISCRETE_DISTRIBUTION_HPP_
+#define BLOCKED_DISCRETE_DISTRIBUTION_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "fast_discrete_distribution_kernels.hpp"
+
+template<typename IntType = int>
+class blocked_discrete_distribution {
+    typedef detail::vose_bucket<double, uint32_t> bucket;
+
+  public:
+    typedef IntType result_type;
+
+    // Size of a page.  Blocks of the default size fill one page each.
+    static const size_t kPageSize = 4096;
+
+    // Number of outcomes per block such that a block fills one page.
+    static const size_t kDefaultBlockSize = kPageSize / sizeof(bucket);
+
+    // block_size must be positive.  Block sizes that are multiples of
+    // kDefaultBlockSize keep every block aligned to a page.
+    blocked_discrete_distribution(const std::vector<double>& weights,
+                                  const size_t block_size = kDefaultBlockSize)
+      : block_size_(block_size), first_(0) {
+      assert(block_size > 0);
+      normalize_weights(weights);
+      create_top(weights);
+      allocate(weights.size());
+      // Scratch space shared by all blocks.
+      std::vector<double> lengths(block_size);
+      std::vector<uint32_t> stacks(block_size);
+      for (size_t b = 0; b < num_blocks(); ++b) {
+        const size_t begin = b * block_size_;
+        create_table(weights.data() + begin, block_length(b), buckets() + begin,
+                     lengths.data(), stacks.data());
+      }
+    }
+
+    // Copies the blocks into storage aligned for the copy.
+    blocked_discrete_distribution(const blocked_discrete_distribution& other)
+      : block_size_(other.block_size_),
+        top_(other.top_),
+        probabilities_(other.probabilities_),
+        first_(0) {
+      allocate(other.probabilities_.size());
+      std::copy(other.buckets(), other.buckets() + probabilities_.size(),
+                buckets());
+    }
+
+    // Moving keeps the storage and therefore its alignment.
+    blocked_discrete_distribution(blocked_discrete_distribution&& other)
+      = default;
+
+    blocked_discrete_distribution& operator=(
+      blocked_discrete_distribution other) {
+      std::swap(block_size_, other.block_size_);
+      std::swap(top_, other.top_);
+      probabilities_.swap(other.probabilities_);
+      storage_.swap(other.storage_);
+      std::swap(first_, other.first_);
+      return *this;
+    }
+
+    template<typename URNG>
+    result_type operator()(URNG& generator) const {
+      if (probabilities_.empty()) return static_cast<result_type>(0);
+      const double number =
+        std::generate_canonical<double, std::numeric_limits<double>::digits>(
+          generator);
+      double position;
+      const size_t b = pick_block(number, &position);
+      return resolve(b, locate(b, position));
+    }
+
+    // Fills [first, last) with samples.  The samples are processed in groups:
+    // first the blocks of the whole group are chosen, then the buckets are
+    // located and prefetched, and only then are the outcomes resolved, so the
+    // cache misses of the top table and of the blocks of a group overlap
+    // instead of forming one dependent chain per sample.  Given the same
+    // generator state, the result is identical to calling operator()
+    // repeatedly.
+    template<typename URNG>
+    void generate(URNG& generator, result_type* first, result_type* last) {
+      if (probabilities_.empty()) {
+        std::fill(first, last, static_cast<result_type>(0));
+        return;
+      }
+      const size_t group_size = 64;
+      size_t blocks[group_size];
+      double scaled[group_size];
+      while (first < last) {
+        const size_t n = std::min<size_t>(group_size, last - first);
+        for (size_t j = 0; j < n; ++j) {
+          const double number =
+            std::generate_canonical<double,
+                                    std::numeric_limits<double>::digits>(
+              generator);
+          blocks[j] = pick_block(number, &scaled[j]);
+        }
+        for (size_t j = 0; j < n; ++j) {
+          scaled[j] = locate(blocks[j], scaled[j]);
+          detail::prefetch(bucket_of(blocks[j], scaled[j]));
+        }
+        for (size_t j = 0; j < n; ++j)
+          first[j] = resolve(blocks[j], scaled[j]);
+        first += n;
+      }
+    }
+
+    size_t block_size() const {
+      return block_size_;
+    }
+
+    size_t num_blocks() const {
+      return (probabilities_.size() + block_size_ - 1) / block_size_;
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(probabilities_.size() - 1);
+    }
+
+    std::vector<double> probabilities() const {
+      return probabilities_;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+    // Recomputes the probability of every outcome implied by the two levels,
+    // the mass of the block in the top table times the mass of the outcome
+    // in the block table, and returns the maximum absolute deviation from
+    // probabilities().
+    double verify() const {
+      const std::vector<double> block_masses =
+        table_masses(top_.data(), top_.size());
+      double max_deviation = 0.0;
+      for (size_t b = 0; b < num_blocks(); ++b) {
+        const size_t begin = b * block_size_;
+        const std::vector<double> mass =
+          table_masses(buckets() + begin, block_length(b));
+        for (size_t k = 0; k < mass.size(); ++k) {
+          max_deviation = std::max(
+            max_deviation, std::fabs(block_masses[b] * mass[k]
+                                     - probabilities_[begin + k]));
+        }
+      }
+      return max_deviation;
+    }
+
+  private:
+    // Probabilities of the n outcomes of an alias table.
+    static std::vector<double> table_masses(const bucket* table,
+                                           const size_t n) {
+      std::vector<double> mass(n, 0.0);
+      for (size_t k = 0; k < n; ++k) {
+        const double fraction =
+          std::min(std::max(table[k].threshold, 0.0), 1.0);
+        mass[k] += fraction / n;
+        mass[table[k].alias] += (1.0 - fraction) / n;
+      }
+      return mass;
+    }
+
+    size_t block_length(const size_t b) const {
+      return std::min(block_size_, probabilities_.size() - b * block_size_);
+    }
+
+    // Maps a uniform number in [0,1) to a block of the top table, and stores
+    // the position of the number inside the segment of the block, a uniform
+    // number in [0,1] given the block, in *position.
+    size_t pick_block(const double number, double* position) const {
+      const size_t size = top_.size();
+      const double scaled = number * size;
+      size_t k = static_cast<size_t>(scaled);
+      if (k >= size) k = size - 1;
+      const double fraction = scaled - k;
+      const bucket& entry = top_[k];
+      if (fraction < entry.threshold) {
+        // Pure buckets have a threshold above 1.
+        *position = fraction / std::min(entry.threshold, 1.0);
+        return k;
+      }
+      *position = (fraction - entry.threshold) / (1.0 - entry.threshold);
+      return entry.alias;
+    }
+
+    // Maps a uniform number in [0,1] to a point in [0, n) of block b with n
+    // outcomes.  The integer part is the bucket, the rest the fraction.
+    double locate(const size_t b, const double number) const {
+      const size_t n = block_length(b);
+      const double scaled = number * n;
+      // Rounding, or a number of 1, may produce n itself; use the end of the
+      // last bucket.
+      return scaled < n ? scaled : std::nextafter(static_cast<double>(n), 0.0);
+    }
+
+    const bucket* bucket_of(const size_t b, const double scaled) const {
+      return buckets() + b * block_size_ + static_cast<size_t>(scaled);
+    }
+
+    result_type resolve(const size_t b, const double scaled) const {
+      const size_t k = static_cast<size_t>(scaled);
+      const bucket& entry = *bucket_of(b, scaled);
+      const size_t local = scaled - k < entry.threshold ? k : entry.alias;
+      return static_cast<result_type>(b * block_size_ + local);
+    }
+
+    void normalize_weights(const std::vector<double>& weights) {
+      const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+      probabilities_.resize(weights.size());
+      detail::divide(weights.data(), sum, probabilities_.data(),
+                     weights.size());
+    }
+
+    // Makes room for num_buckets buckets starting at a page boundary.
+    void allocate(const size_t num_buckets) {
+      const size_t slack = kPageSize / sizeof(bucket) - 1;
+      storage_.assign(num_buckets + slack, bucket());
+      const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.data());
+      first_ = ((kPageSize - address % kPageSize) % kPageSize) / sizeof(bucket);
+    }
+
+    bucket* buckets() {
+      return storage_.data() + first_;
+    }
+
+    const bucket* buckets() const {
+      return storage_.data() + first_;
+    }
+
+    // Builds the top table from the total weights of the blocks.
+    void create_top(const std::vector<double>& weights) {
+      std::vector<double> sums(num_blocks(), 0.0);
+      for (size_t i = 0; i < weights.size(); ++i)
+        sums[i / block_size_] += weights[i];
+      top_.resize(std::max<size_t>(sums.size(), 1));
+      if (sums.empty()) {
+        make_pure(top_.data(), 0);
+        return;
+      }
+      std::vector<double> lengths(sums.size());
+      std::vector<uint32_t> stacks(sums.size());
+      create_table(sums.data(), sums.size(), top_.data(), lengths.data(),
+                   stacks.data());
+    }
+
+    // Builds an alias table of n outcomes from their weights.  lengths and
+    // stacks are scratch space for n values each.  The lengths of the
+    // segments are in units of a bucket.
+    static void create_table(const double* weights, const size_t n,
+                             bucket* table, double* lengths,
+                             uint32_t* stacks) {
+      assert(n - 1 <= std::numeric_limits<uint32_t>::max());
+
+      double sum = 0.0;
+      for (size_t k = 0; k < n; ++k) sum += weights[k];
+      if (!(sum > 0.0)) {
+        for (size_t k = 0; k < n; ++k) make_pure(table, k);
+        return;
+      }
+
+      for (size_t k = 0; k < n; ++k) lengths[k] = weights[k] / sum * n;
+
+      // Two stacks of outcomes in one array.  The small stack grows from the
+      // beginning, the large stack from the end.
+      size_t num_small = 0;
+      size_t num_large = 0;
+      for (size_t k = 0; k < n; ++k) {
+        if (lengths[k] < 1.0)
+          stacks[num_small++] = static_cast<uint32_t>(k);
+        else
+          stacks[n - 1 - num_large++] = static_cast<uint32_t>(k);
+      }
+
+      while (num_small > 0 && num_large > 0) {
+        const size_t s = stacks[--num_small];
+        const size_t l = stacks[n - num_large--];
+        table[s].threshold = lengths[s];
+        table[s].alias = static_cast<uint32_t>(l);
+        lengths[l] = (lengths[l] + lengths[s]) - 1.0;
+        if (lengths[l] < 1.0)
+          stacks[num_small++] = static_cast<uint32_t>(l);
+        else
+          stacks[n - 1 - num_large++] = static_cast<uint32_t>(l);
+      }
+
+      // Pure buckets.  Left-over small segments can only be due to rounding.
+      while (num_large > 0) make_pure(table, stacks[n - num_large--]);
+      while (num_small > 0) make_pure(table, stacks[--num_small]);
+    }
+
+    static void make_pure(bucket* table, const size_t k) {
+      table[k].threshold = 2.0;
+      table[k].alias = static_cast<uint32_t>(k);
+    }
+
+    // Number of outcomes per block.
+    size_t block_size_;
+
+    // Alias table over the blocks.
+    std::vector<bucket> top_;
+
+    // List of probabilities
+    std::vector<double> probabilities_;
+
+    // The block tables, block b at buckets()[b * block_size_, ...).  storage_
+    // has room to start buckets() at a page boundary; first_ is its offset.
+    std::vector<bucket> storage_;
+    size_t first_;
+};
+
+template<typename IntType>
+const size_t blocked_discrete_distribution<IntType>::kPageSize;
+
+template<typename IntType>
+const size_t blocked_discrete_distribution<IntType>::kDefaultBlockSize;
+
+#endif  // BLOCKED_DISCRETE_DISTRIBUTION_HPP_
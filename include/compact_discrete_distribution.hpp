@@ -0,0 +1,195 @@
+// Discrete distribution with a compact alias table for small supports.
+//
+// A bucket of fast_discrete_distribution<int> holds two outcomes and a double
+// threshold, 16 bytes.  For supports of at most 2^B outcomes, where B is the
+// number of bits of IndexType (8 or 16), compact_discrete_distribution stores
+// a bucket in two IndexType values: the alias and a B-bit threshold.  With
+// uint16_t a bucket takes 4 bytes, so a table of 16384 outcomes takes 64 KiB
+// instead of 256 KiB and stays in the L1 or L2 cache.
+//
+// The table uses Vose's layout: bucket k belongs to outcome k below its
+// threshold and to its alias above it.  A sample draws one integer x uniformly
+// from [0, N 2^B); the bucket is x / 2^B and the point inside the bucket is
+// x mod 2^B.  With a 31-bit engine such as std::default_random_engine this
+// takes two engine calls, as many as the double of fast_discrete_distribution,
+// so the smaller table saves memory but not time while both tables fit into
+// the cache.
+//
+// Accuracy.  The threshold of a bucket is the length of its first segment
+// rounded to a multiple of 2^-B of the bucket, so each bucket moves at most
+// 2^-(B+1) / N of probability between its two outcomes.  The probability of
+// outcome i is therefore off by at most c_i 2^-(B+1) / N, where c_i is the
+// number of buckets holding i, and the total variation distance to the
+// requested distribution is at most 2^-(B+1): 7.6e-6 for uint16_t and 2e-3
+// for uint8_t.  table_probabilities() returns the probabilities that the
+// table actually realizes.
+
+#ifndef COMPACT_DISCRETE_DISTRIBUTION_HPP_
+#define COMPACT_DISCRETE_DISTRIBUTION_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+template<typename IntType = int, typename IndexType = uint16_t>
+class compact_discrete_distribution {
+    static_assert(std::is_unsigned<IndexType>::value
+                  && sizeof(IndexType) <= sizeof(uint16_t),
+                  "IndexType must be uint8_t or uint16_t.");
+
+  public:
+    typedef IntType result_type;
+    typedef IndexType index_type;
+
+    // Number of bits of a threshold.
+    static const int kBits = std::numeric_limits<IndexType>::digits;
+
+    // Largest number of outcomes.
+    static const size_t kMaxSupport = static_cast<size_t>(1) << kBits;
+
+    // weights.size() must not exceed kMaxSupport.
+    compact_discrete_distribution(const std::vector<double>& weights)
+      : uniform_distribution_(
+          0, static_cast<uint32_t>((std::max<size_t>(weights.size(), 1)
+                                    << kBits) - 1)) {
+      assert(weights.size() <= kMaxSupport);
+      normalize_weights(weights);
+      create_buckets();
+    }
+
+    template<typename URNG>
+    result_type operator()(URNG& generator) {
+      const size_t N = buckets_.size();
+      if (N == 0) return static_cast<result_type>(0);
+      const size_t x = uniform_distribution_(generator);
+      const size_t index = x >> kBits;
+      const size_t point = x & (kMaxSupport - 1);
+      const bucket& b = buckets_[index];
+      return static_cast<result_type>(point < b.threshold ? index : b.alias);
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(probabilities_.size() - 1);
+    }
+
+    std::vector<double> probabilities() const {
+      return probabilities_;
+    }
+
+    // The probabilities implied by the rounded thresholds; see the accuracy
+    // bound at the top of this file.
+    std::vector<double> table_probabilities() const {
+      const size_t N = buckets_.size();
+      std::vector<double> probabilities(N, 0.0);
+      for (size_t k = 0; k < N; ++k) {
+        const double first =
+          static_cast<double>(buckets_[k].threshold) / kMaxSupport;
+        const size_t alias = buckets_[k].alias;
+        if (alias == k) {
+          probabilities[k] += 1.0 / N;
+        } else {
+          probabilities[k] += first / N;
+          probabilities[alias] += (1.0 - first) / N;
+        }
+      }
+      return probabilities;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+  private:
+    // Bucket k maps points below threshold to outcome k and the others to
+    // alias.  A pure bucket has alias k.
+    struct bucket {
+      IndexType threshold;
+      IndexType alias;
+    };
+
+    void normalize_weights(const std::vector<double>& weights) {
+      const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+      probabilities_.reserve(weights.size());
+      for (auto weight : weights) {
+        probabilities_.push_back(weight / sum);
+      }
+    }
+
+    void create_buckets() {
+      const size_t N = probabilities_.size();
+      buckets_.resize(N);
+      if (N == 0) return;
+
+      // Lengths of the segments in units of 1/N.
+      std::vector<double> lengths(N);
+      for (size_t i = 0; i < N; ++i) lengths[i] = probabilities_[i] * N;
+
+      // Two stacks of outcomes in one vector.  The small stack grows from the
+      // beginning, the large stack from the end.
+      std::vector<IndexType> stacks(N);
+      size_t num_small = 0;
+      size_t num_large = 0;
+      for (size_t i = 0; i < N; ++i) {
+        if (lengths[i] < 1.0)
+          stacks[num_small++] = static_cast<IndexType>(i);
+        else
+          stacks[N - 1 - num_large++] = static_cast<IndexType>(i);
+      }
+
+      while (num_small > 0 && num_large > 0) {
+        const size_t s = stacks[--num_small];
+        const size_t l = stacks[N - num_large--];
+
+        // A segment that rounds to the whole bucket makes the bucket pure.
+        const double threshold = std::round(lengths[s] * kMaxSupport);
+        if (threshold >= kMaxSupport) {
+          make_pure(s);
+        } else {
+          buckets_[s].threshold = static_cast<IndexType>(threshold);
+          buckets_[s].alias = static_cast<IndexType>(l);
+        }
+
+        lengths[l] = (lengths[l] + lengths[s]) - 1.0;
+        if (lengths[l] < 1.0)
+          stacks[num_small++] = static_cast<IndexType>(l);
+        else
+          stacks[N - 1 - num_large++] = static_cast<IndexType>(l);
+      }
+
+      // Pure buckets.  Left-over small segments can only be due to rounding.
+      while (num_large > 0) make_pure(stacks[N - num_large--]);
+      while (num_small > 0) make_pure(stacks[--num_small]);
+    }
+
+    void make_pure(const size_t k) {
+      buckets_[k].threshold = 0;
+      buckets_[k].alias = static_cast<IndexType>(k);
+    }
+
+    // Uniform distribution over [0, N 2^B).  N 2^B is at most 2^32.
+    std::uniform_int_distribution<uint32_t> uniform_distribution_;
+
+    // List of probabilities
+    std::vector<double> probabilities_;
+    std::vector<bucket> buckets_;
+};
+
+template<typename IntType, typename IndexType>
+const int compact_discrete_distribution<IntType, IndexType>::kBits;
+
+template<typename IntType, typename IndexType>
+const size_t compact_discrete_distribution<IntType, IndexType>::kMaxSupport;
+
+#endif  // COMPACT_DISCRETE_DISTRIBUTION_HPP_
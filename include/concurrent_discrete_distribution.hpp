@@ -0,0 +1,150 @@
+// Discrete distribution that can be sampled by many threads while another
+// thread replaces its weights.
+//
+// The table is a fast_discrete_distribution that is never modified once
+// published.  update() builds a new table off to the side, publishes it with
+// one atomic store and frees the old table once no reader can still be using
+// it.  Readers never take a lock and never wait for a writer.
+//
+// Reclamation is epoch based.  Every reader thread owns a slot on a cache
+// line of its own and announces itself in the slot's counter for the current
+// epoch (even or odd) before it loads the table, and withdraws after
+// sampling.  A writer publishes the new table, advances the epoch and scans
+// the slots until every counter of the previous epoch has dropped to zero;
+// from then on no reader can hold the old table.  A reader that sees the
+// epoch change between reading it and announcing itself retries, so it is
+// always counted in an epoch the next writer waits for.  Readers therefore
+// write only to their own cache line, which the writer reads once per update.
+// Threads are assigned slots round robin; beyond kNumSlots threads, slots are
+// shared, which stays correct and only brings back some contention.  Writers
+// are serialized by a mutex.
+
+#ifndef CONCURRENT_DISCRETE_DISTRIBUTION_HPP_
+#define CONCURRENT_DISCRETE_DISTRIBUTION_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fast_discrete_distribution.hpp"
+
+template<typename IntType = int>
+class concurrent_discrete_distribution {
+  public:
+    typedef IntType result_type;
+    typedef fast_discrete_distribution<IntType> table_type;
+    typedef typename table_type::param_type param_type;
+
+    // Number of reader slots.
+    static const size_t kNumSlots = 64;
+
+    explicit concurrent_discrete_distribution(param_type param)
+      : table_(new table_type(std::move(param))), epoch_(0) {
+      for (auto& slot : slots_) {
+        slot.count[0].store(0);
+        slot.count[1].store(0);
+      }
+    }
+
+    ~concurrent_discrete_distribution() {
+      delete table_.load();
+    }
+
+    concurrent_discrete_distribution(const concurrent_discrete_distribution&)
+      = delete;
+    concurrent_discrete_distribution& operator=(
+      const concurrent_discrete_distribution&) = delete;
+
+    // Samples from the current table.  Safe to call from any number of
+    // threads at the same time as update().
+    template<typename URNG>
+    result_type operator()(URNG& generator) const {
+      const read_guard guard(*this);
+      return (*guard.table)(generator, guard.table->param());
+    }
+
+    // Replaces the table by one built from param, e.g. from a new vector of
+    // weights.  The table is built before any lock is taken.  Returns after
+    // the old table is freed, i.e. after every reader that may have loaded it
+    // has finished.
+    void update(param_type param) {
+      table_type* table = new table_type(std::move(param));
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      const table_type* old_table = table_.exchange(table);
+      const uint64_t old_epoch = epoch_.fetch_add(1);
+      for (const auto& slot : slots_) {
+        const std::atomic<size_t>& readers = slot.count[old_epoch & 1];
+        while (readers.load() != 0) std::this_thread::yield();
+      }
+      delete old_table;
+    }
+
+    result_type min() const {
+      const read_guard guard(*this);
+      return guard.table->min();
+    }
+
+    result_type max() const {
+      const read_guard guard(*this);
+      return guard.table->max();
+    }
+
+    std::vector<double> probabilities() const {
+      const read_guard guard(*this);
+      return guard.table->probabilities();
+    }
+
+    void reset() {
+      // Empty
+    }
+
+  private:
+    // Announces a reader in its slot's counter of the current epoch for its
+    // lifetime and loads the table.
+    struct read_guard {
+      explicit read_guard(const concurrent_discrete_distribution& owner) {
+        reader_slot& slot = owner.slots_[thread_slot()];
+        for (;;) {
+          const uint64_t epoch = owner.epoch_.load();
+          readers = &slot.count[epoch & 1];
+          readers->fetch_add(1);
+          if (owner.epoch_.load() == epoch) break;
+          readers->fetch_sub(1);
+        }
+        table = owner.table_.load();
+      }
+
+      ~read_guard() {
+        readers->fetch_sub(1);
+      }
+
+      std::atomic<size_t>* readers;
+      const table_type* table;
+    };
+
+    // The counters of both epochs of one reader slot, on a cache line of
+    // their own.
+    struct alignas(64) reader_slot {
+      std::atomic<size_t> count[2];
+    };
+
+    // Slot of the calling thread, the same for every distribution.
+    static size_t thread_slot() {
+      static std::atomic<size_t> next_slot(0);
+      thread_local const size_t slot = next_slot.fetch_add(1) % kNumSlots;
+      return slot;
+    }
+
+    std::atomic<const table_type*> table_;
+    std::atomic<uint64_t> epoch_;
+    mutable reader_slot slots_[kNumSlots];
+    std::mutex writer_mutex_;
+};
+
+template<typename IntType>
+const size_t concurrent_discrete_distribution<IntType>::kNumSlots;
+
+#endif  // CONCURRENT_DISCRETE_DISTRIBUTION_HPP_
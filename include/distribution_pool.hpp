@@ -0,0 +1,227 @@
+// Many small discrete distributions stored in one arena.
+//
+// Random walks on graphs need one distribution per node over the node's
+// neighbours.  Storing a separate fast_discrete_distribution per node costs
+// two heap allocations and their headers per node.  distribution_pool takes
+// the weights in compressed sparse row (CSR) form, i.e. distribution v has the
+// weights weights[offsets[v]], ..., weights[offsets[v+1]-1], and stores the
+// alias tables of all distributions in two flat arrays indexed the same way.
+// The tables use Vose's layout: bucket k of a distribution belongs to outcome
+// k up to its threshold and to its alias above it.
+//
+// sample(v, generator) returns an outcome in [0, offsets[v+1] - offsets[v]),
+// i.e. the position of the chosen neighbour in the CSR row.
+
+#ifndef DISTRIBUTION_POOL_HPP_
+#define DISTRIBUTION_POOL_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "fast_discrete_distribution_kernels.hpp"
+
+template<typename IntType = int>
+class distribution_pool {
+  public:
+    typedef IntType result_type;
+
+    // offsets has one more element than there are distributions, starts with 0
+    // and ends with weights.size().  The distributions are built in parallel
+    // by num_threads threads.
+    distribution_pool(const std::vector<size_t>& offsets,
+                      const std::vector<double>& weights,
+                      size_t num_threads = 1)
+      : offsets_(offsets),
+        thresholds_(weights),
+        aliases_(weights.size()) {
+      assert(!offsets_.empty() && offsets_.front() == 0
+             && offsets_.back() == weights.size());
+      build(num_threads);
+    }
+
+    // Number of distributions.
+    size_t size() const {
+      return offsets_.size() - 1;
+    }
+
+    // Number of outcomes of distribution v.
+    size_t support_size(const size_t v) const {
+      return offsets_[v + 1] - offsets_[v];
+    }
+
+    // Draws an outcome of distribution v.  Returns 0 if v has no outcomes.
+    template<typename URNG>
+    result_type sample(const size_t v, URNG& generator) const {
+      const double number =
+        std::generate_canonical<double, std::numeric_limits<double>::digits>(
+          generator);
+      return sample_from_uniform(v, number);
+    }
+
+    // Draws one outcome of distribution first[i] into out[i] for every i in
+    // [0, last - first).  The result is the same as calling sample() for each
+    // id in turn.  The lookups are processed in blocks: first the offsets of
+    // all distributions in the block are prefetched, then the buckets, and
+    // only then are the outcomes resolved, so the cache misses of independent
+    // lookups overlap instead of being paid one after another.
+    template<typename URNG>
+    void sample_many(const size_t* first, const size_t* last,
+                     URNG& generator, result_type* out) const {
+      const size_t block_size = 64;
+      double scaled[block_size];
+      size_t positions[block_size];
+      while (first < last) {
+        const size_t n = std::min<size_t>(block_size, last - first);
+        for (size_t j = 0; j < n; ++j) {
+          scaled[j] =
+            std::generate_canonical<double,
+                                    std::numeric_limits<double>::digits>(
+              generator);
+          detail::prefetch(&offsets_[first[j]]);
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          const size_t begin = offsets_[first[j]];
+          const size_t support = offsets_[first[j] + 1] - begin;
+          scaled[j] *= support;
+          size_t k = static_cast<size_t>(scaled[j]);
+          if (k >= support) k = support - 1;
+          // Distributions without outcomes have no bucket and return 0.
+          positions[j] = support == 0 ? std::numeric_limits<size_t>::max()
+                                      : begin + k;
+          if (support != 0) {
+            detail::prefetch(&thresholds_[begin + k]);
+            detail::prefetch(&aliases_[begin + k]);
+          }
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+          const size_t position = positions[j];
+          if (position == std::numeric_limits<size_t>::max()) {
+            out[j] = static_cast<result_type>(0);
+            continue;
+          }
+          const size_t k = position - offsets_[first[j]];
+          const result_type alias = aliases_[position];
+          const result_type below = scaled[j] - k < thresholds_[position];
+          out[j] = alias + below * (static_cast<result_type>(k) - alias);
+        }
+
+        first += n;
+        out += n;
+      }
+    }
+
+  private:
+    // Maps a uniform number in [0,1) to an outcome of distribution v.
+    result_type sample_from_uniform(const size_t v, const double number) const {
+      const size_t begin = offsets_[v];
+      const size_t n = offsets_[v + 1] - begin;
+      if (n == 0) return static_cast<result_type>(0);
+
+      const double scaled = number * n;
+      size_t k = static_cast<size_t>(scaled);
+      if (k >= n) k = n - 1;
+      const result_type alias = aliases_[begin + k];
+      const result_type below = scaled - k < thresholds_[begin + k];
+      return alias + below * (static_cast<result_type>(k) - alias);
+    }
+
+    void build(size_t num_threads) {
+      const size_t num_distributions = size();
+      num_threads = std::max<size_t>(1, std::min(num_threads,
+                                                 num_distributions));
+      if (num_threads == 1) {
+        build_range(0, num_distributions);
+        return;
+      }
+
+      // Split the distributions into ranges with about the same number of
+      // outcomes.
+      const size_t total = offsets_.back();
+      std::vector<size_t> boundaries(1, 0);
+      for (size_t t = 1; t < num_threads; ++t) {
+        const size_t target = total * t / num_threads;
+        boundaries.push_back(std::max(
+          boundaries.back(),
+          static_cast<size_t>(std::lower_bound(offsets_.begin(), offsets_.end(),
+                                               target) - offsets_.begin())));
+      }
+      boundaries.push_back(num_distributions);
+
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < num_threads; ++t) {
+        const size_t first = std::min(boundaries[t], num_distributions);
+        const size_t last = std::min(boundaries[t + 1], num_distributions);
+        threads.emplace_back([this, first, last]() {
+          build_range(first, last);
+        });
+      }
+      for (auto& thread : threads) thread.join();
+    }
+
+    // Builds distributions first, ..., last - 1.  On entry thresholds_ holds
+    // the weights.  The segment lengths are computed in place, and each
+    // threshold becomes final when its outcome is paired as the small segment.
+    void build_range(const size_t first, const size_t last) {
+      std::vector<size_t> stacks;
+      for (size_t v = first; v < last; ++v) {
+        const size_t begin = offsets_[v];
+        const size_t n = offsets_[v + 1] - begin;
+        double* lengths = thresholds_.data() + begin;
+        result_type* aliases = aliases_.data() + begin;
+
+        double sum = 0.0;
+        for (size_t k = 0; k < n; ++k) sum += lengths[k];
+
+        // Two stacks in one vector.  The small stack grows from the
+        // beginning, the large stack from the end.
+        stacks.resize(n);
+        size_t num_small = 0;
+        size_t num_large = 0;
+        for (size_t k = 0; k < n; ++k) {
+          lengths[k] = lengths[k] / sum * n;
+          if (lengths[k] < 1.0)
+            stacks[num_small++] = k;
+          else
+            stacks[n - 1 - num_large++] = k;
+        }
+
+        while (num_small > 0 && num_large > 0) {
+          const size_t s = stacks[--num_small];
+          const size_t l = stacks[n - num_large--];
+          aliases[s] = static_cast<result_type>(l);
+          lengths[l] = (lengths[l] + lengths[s]) - 1.0;
+          if (lengths[l] < 1.0)
+            stacks[num_small++] = l;
+          else
+            stacks[n - 1 - num_large++] = l;
+        }
+
+        // Pure buckets.  Left-over small segments can only be due to rounding.
+        while (num_large > 0) make_pure(lengths, aliases, stacks[n - num_large--]);
+        while (num_small > 0) make_pure(lengths, aliases, stacks[--num_small]);
+      }
+    }
+
+    static void make_pure(double* thresholds, result_type* aliases,
+                          const size_t k) {
+      thresholds[k] = 2.0;
+      aliases[k] = static_cast<result_type>(k);
+    }
+
+    // Distribution v owns positions offsets_[v], ..., offsets_[v+1]-1 of
+    // thresholds_ and aliases_.
+    std::vector<size_t> offsets_;
+
+    // Bucket k of distribution v maps fractions below thresholds_[offsets_[v]+k]
+    // to outcome k and the others to aliases_[offsets_[v]+k].
+    std::vector<double> thresholds_;
+    std::vector<result_type> aliases_;
+};
+
+#endif  // DISTRIBUTION_POOL_HPP_
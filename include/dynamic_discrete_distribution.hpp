@@ -0,0 +1,292 @@
+// Discrete distribution whose weights can be changed one at a time without
+// rebuilding the whole table.
+//
+// The table is an alias table in weight units: every bucket has capacity
+// c = W / N, where W is the sum of the weights at the last full build, and
+// holds up to two outcomes with masses that add up to at most c.  A sample
+// picks a bucket uniformly and a point in [0, c).  The point selects the first
+// outcome, the second outcome, or falls into the unused rest of the bucket, in
+// which case the sample is retried.
+//
+// Every outcome keeps a list of the bucket slots it occupies.  set_weight()
+// removes the outcome from its slots, which leaves holes, and places the new
+// weight into buckets with a free slot: first into buckets that have only one
+// outcome, then into empty buckets from a reserve of N/16 spare buckets, and
+// finally into new buckets appended to the table.  The cost is proportional to
+// the number of slots of the outcome, O(1 + w / c) for weight w, instead of
+// O(N).  Holes lower the acceptance rate W / (B c), where B is the number of
+// buckets; once it drops below 1/2, or once growing weights have doubled the
+// number of buckets, the table is rebuilt.
+
+#ifndef DYNAMIC_DISCRETE_DISTRIBUTION_HPP_
+#define DYNAMIC_DISCRETE_DISTRIBUTION_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+template<typename IntType = int>
+class dynamic_discrete_distribution {
+  public:
+    typedef IntType result_type;
+
+    dynamic_discrete_distribution(const std::vector<double>& weights)
+      : weights_(weights) {
+      rebuild();
+    }
+
+    // Draws an outcome.  Returns 0 if all weights are zero.
+    template<typename URNG>
+    result_type operator()(URNG& generator) const {
+      if (!(total_ > 0.0)) return static_cast<result_type>(0);
+      const size_t num_buckets = slots_.size() / 2;
+      for (;;) {
+        const double scaled =
+          std::generate_canonical<double, std::numeric_limits<double>::digits>(
+            generator) * num_buckets;
+        size_t k = static_cast<size_t>(scaled);
+        if (k >= num_buckets) k = num_buckets - 1;
+        const double point = (scaled - k) * capacity_;
+        const slot& first = slots_[2 * k];
+        const slot& second = slots_[2 * k + 1];
+        if (point < first.mass)
+          return static_cast<result_type>(first.outcome);
+        if (point < first.mass + second.mass)
+          return static_cast<result_type>(second.outcome);
+      }
+    }
+
+    // Changes the weight of an outcome.  weight must be non-negative.
+    void set_weight(const size_t outcome, const double weight) {
+      assert(outcome < weights_.size() && weight >= 0.0);
+      remove(outcome);
+      total_ += weight - weights_[outcome];
+      weights_[outcome] = weight;
+      // A weight that needs more buckets than the table has is cheaper to
+      // handle by a rebuild, which also adjusts the capacity.
+      if (weight > capacity_ * (slots_.size() / 2)) {
+        rebuild();
+        return;
+      }
+      place(outcome, weight);
+      const size_t num_buckets = slots_.size() / 2;
+      if (total_ < 0.5 * capacity_ * num_buckets
+          || num_buckets > 2 * rebuilt_buckets_)
+        rebuild();
+    }
+
+    double weight(const size_t outcome) const {
+      return weights_[outcome];
+    }
+
+    // Probability that a sample is not retried.
+    double acceptance() const {
+      return slots_.empty() ? 1.0
+                            : total_ / (capacity_ * (slots_.size() / 2));
+    }
+
+    // Rebuilds the table from the current weights, removing all holes.
+    void rebuild() {
+      const size_t N = weights_.size();
+      total_ = std::accumulate(weights_.begin(), weights_.end(), 0.0);
+      head_.assign(N, kNone);
+      slots_.clear();
+      empty_.clear();
+      half_full_.clear();
+      rebuilt_buckets_ = 0;
+      if (N == 0 || !(total_ > 0.0)) {
+        capacity_ = 1.0;
+        return;
+      }
+      capacity_ = total_ / N;
+
+      const size_t num_buckets = N + N / 16 + 1;
+      slots_.assign(2 * num_buckets, slot());
+      rebuilt_buckets_ = num_buckets;
+
+      // Two stacks in one vector.  The small stack grows from the beginning,
+      // the large stack from the end.  Outcomes with zero weight occupy no
+      // slot.
+      std::vector<size_t> stacks(N);
+      std::vector<double> lengths(weights_);
+      size_t num_small = 0;
+      size_t num_large = 0;
+      for (size_t i = 0; i < N; ++i) {
+        if (!(lengths[i] > 0.0)) continue;
+        if (lengths[i] < capacity_)
+          stacks[num_small++] = i;
+        else
+          stacks[N - 1 - num_large++] = i;
+      }
+
+      size_t k = 0;
+      while (num_small > 0 && num_large > 0) {
+        const size_t s = stacks[--num_small];
+        const size_t l = stacks[N - num_large--];
+        occupy(2 * k, s, lengths[s]);
+        occupy(2 * k + 1, l, capacity_ - lengths[s]);
+        lengths[l] = (lengths[l] + lengths[s]) - capacity_;
+        if (lengths[l] < capacity_)
+          stacks[num_small++] = l;
+        else
+          stacks[N - 1 - num_large++] = l;
+        ++k;
+      }
+
+      // The remaining buckets are the reserve.  Whatever is left of the
+      // outcomes (several buckets' worth for an outcome whose weight exceeds
+      // the capacity of the unpaired buckets, or rounding residue) is placed
+      // like an update.
+      for (size_t b = num_buckets; b > k; --b) empty_.push_back(b - 1);
+      while (num_large > 0) {
+        const size_t l = stacks[N - num_large--];
+        place(l, lengths[l]);
+      }
+      while (num_small > 0) {
+        const size_t s = stacks[--num_small];
+        if (lengths[s] > 0.0) place(s, lengths[s]);
+      }
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return weights_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(weights_.size() - 1);
+    }
+
+    std::vector<double> probabilities() const {
+      const double sum =
+        std::accumulate(weights_.begin(), weights_.end(), 0.0);
+      std::vector<double> probabilities;
+      probabilities.reserve(weights_.size());
+      for (auto weight : weights_) probabilities.push_back(weight / sum);
+      return probabilities;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+  private:
+    static const size_t kNone = static_cast<size_t>(-1);
+
+    // Slots 2k and 2k + 1 are bucket k.  An empty slot has mass 0 and outcome
+    // kNone.  next links the slots of the same outcome.
+    struct slot {
+      slot() : mass(0.0), outcome(kNone), next(kNone) { }
+
+      double mass;
+      size_t outcome;
+      size_t next;
+    };
+
+    void occupy(const size_t index, const size_t outcome, const double mass) {
+      slot& s = slots_[index];
+      s.mass = mass;
+      s.outcome = outcome;
+      s.next = head_[outcome];
+      head_[outcome] = index;
+    }
+
+    // Frees the slots of the outcome.  Their buckets become half full or
+    // empty.
+    void remove(const size_t outcome) {
+      size_t index = head_[outcome];
+      while (index != kNone) {
+        slot& s = slots_[index];
+        const size_t next = s.next;
+        s = slot();
+        if (slots_[index ^ 1].outcome == kNone)
+          empty_.push_back(index / 2);
+        else
+          half_full_.push_back(index / 2);
+        index = next;
+      }
+      head_[outcome] = kNone;
+    }
+
+    // Distributes mass of the outcome over buckets with a free slot.
+    void place(const size_t outcome, double mass) {
+      while (mass > 0.0) {
+        size_t index;
+        double space;
+        if (!pop_half_full(&index, &space)) {
+          if (!pop_empty(&index)) {
+            index = slots_.size();
+            slots_.resize(slots_.size() + 2);
+          }
+          space = capacity_;
+        }
+        const double put = mass < space ? mass : space;
+        occupy(index, outcome, put);
+        mass -= put;
+        // A bucket that got its first outcome may take a second one.
+        if (put < space && slots_[index ^ 1].outcome == kNone)
+          half_full_.push_back(index / 2);
+      }
+    }
+
+    // Pops a bucket with exactly one outcome and room left.  Stale entries,
+    // whose bucket has changed since it was pushed, are skipped.
+    bool pop_half_full(size_t* index, double* space) {
+      while (!half_full_.empty()) {
+        const size_t k = half_full_.back();
+        half_full_.pop_back();
+        const slot& first = slots_[2 * k];
+        const slot& second = slots_[2 * k + 1];
+        if ((first.outcome == kNone) == (second.outcome == kNone)) continue;
+        const size_t free = first.outcome == kNone ? 2 * k : 2 * k + 1;
+        const double room = capacity_ - slots_[free ^ 1].mass;
+        if (!(room > 0.0)) continue;
+        *index = free;
+        *space = room;
+        return true;
+      }
+      return false;
+    }
+
+    bool pop_empty(size_t* index) {
+      while (!empty_.empty()) {
+        const size_t k = empty_.back();
+        empty_.pop_back();
+        if (slots_[2 * k].outcome != kNone
+            || slots_[2 * k + 1].outcome != kNone) continue;
+        *index = 2 * k;
+        return true;
+      }
+      return false;
+    }
+
+    std::vector<double> weights_;
+
+    // Sum of the weights, updated incrementally between rebuilds.
+    double total_;
+
+    // Capacity of a bucket.
+    double capacity_;
+
+    std::vector<slot> slots_;
+
+    // Number of buckets after the last rebuild.
+    size_t rebuilt_buckets_;
+
+    // head_[i] is the first slot of outcome i, or kNone.
+    std::vector<size_t> head_;
+
+    // Buckets that are empty, and buckets with one outcome and room for a
+    // second.  Both may contain stale entries.
+    std::vector<size_t> empty_;
+    std::vector<size_t> half_full_;
+};
+
+template<typename IntType>
+const size_t dynamic_discrete_distribution<IntType>::kNone;
+
+#endif  // DYNAMIC_DISCRETE_DISTRIBUTION_HPP_
@@ -0,0 +1,892 @@
+// C++ implementation of a fast algorithm for generating samples from a
+// discrete distribution.
+//
+// David Pal, December 2015
+//
+// Header-only.  Include this file and compile with -std=c++11 -pthread.
+
+#ifndef FAST_DISCRETE_DISTRIBUTION_HPP_
+#define FAST_DISCRETE_DISTRIBUTION_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "fast_discrete_distribution_kernels.hpp"
+
+namespace detail {
+// Stack that does not own the underlying storage.
+template<typename T, typename BidirectionalIterator>
+class stack_view {
+  public:
+    stack_view(const BidirectionalIterator base)
+      : base_(base), top_(base) { };
+
+    void push(const T& element) {
+      *top_ = element;
+      ++top_;
+    }
+
+    T pop() {
+      --top_;
+      return *top_;
+    }
+
+    bool empty() {
+      return top_ == base_;
+    }
+
+  private:
+    const BidirectionalIterator base_;
+    BidirectionalIterator top_;
+};
+
+// Scratch storage that a table reuses across rebuilds.  Copies of the table
+// start with empty scratch storage.
+template<typename T>
+struct scratch_vector {
+  scratch_vector() { }
+  scratch_vector(const scratch_vector&) { }
+  scratch_vector(scratch_vector&&) = default;
+  scratch_vector& operator=(const scratch_vector&) { return *this; }
+  scratch_vector& operator=(scratch_vector&&) = default;
+
+  std::vector<T> data;
+};
+}
+
+// Marks functions that can be evaluated at compile time.  Mutating
+// std::array elements in constant expressions requires C++17.
+#if __cplusplus >= 201703L
+#define FDD_CONSTEXPR constexpr
+#else
+#define FDD_CONSTEXPR
+#endif
+
+// Value of the second template parameter of fast_discrete_distribution for
+// distributions whose number of outcomes is known only at run time.
+const size_t dynamic_support = static_cast<size_t>(-1);
+
+// fast_discrete_distribution<IntType> has a support size chosen at run time.
+// fast_discrete_distribution<IntType, N> has exactly N outcomes and stores its
+// table in std::arrays; see the definition at the end of this file.
+template<typename IntType = int, size_t Support = dynamic_support>
+class fast_discrete_distribution;
+
+template<typename IntType>
+class fast_discrete_distribution<IntType, dynamic_support> {
+  public:
+    typedef IntType result_type;
+
+  private:
+    typedef std::pair<uint64_t, size_t> ExactSegment;
+    typedef std::tuple<result_type, result_type, double> Bucket;
+
+  public:
+    // The parameters of the distribution: the probabilities together with
+    // the bucket table built from them.  Copying a param_type copies the
+    // table without rebuilding it, so a table can be built once and given to
+    // many distributions.  assign() rebuilds the table from new weights in
+    // the storage already allocated.
+    class param_type {
+      public:
+        typedef fast_discrete_distribution distribution_type;
+
+        param_type() : param_type(std::vector<double>()) { }
+
+        param_type(const std::vector<double>& weights)
+          : param_type(weights.begin(), weights.end()) { }
+
+        // Takes over the storage of the weights, which become the
+        // probabilities after normalization in place.  Construction then
+        // allocates only the buckets and one index per outcome of scratch
+        // space.
+        param_type(std::vector<double>&& weights)
+          : probabilities_(std::move(weights)) {
+          normalize_weights();
+          create_buckets();
+        }
+
+        // Weights from any range.  The weights are read once, directly into
+        // the storage of the probabilities, and normalized there, so no copy
+        // of the weights is made.  first and last may be input iterators.
+        template<typename InputIt, typename = typename
+                   std::iterator_traits<InputIt>::iterator_category>
+        param_type(InputIt first, InputIt last) {
+          assign(first, last);
+        }
+
+        param_type(std::initializer_list<double> weights)
+          : param_type(weights.begin(), weights.end()) { }
+
+        // Like std::discrete_distribution: count outcomes (one if count is 0)
+        // where outcome k has weight fw(xmin + (k + 0.5) * delta) and
+        // delta = (xmax - xmin) / count.  fw is called once per outcome.
+        template<typename UnaryOperation>
+        param_type(const size_t count, const double xmin, const double xmax,
+                   UnaryOperation fw) {
+          const size_t N = count == 0 ? 1 : count;
+          const double delta = (xmax - xmin) / N;
+          probabilities_.resize(N);
+          for (size_t k = 0; k < N; ++k)
+            probabilities_[k] = fw(xmin + k * delta + delta / 2);
+          normalize_weights();
+          create_buckets();
+        }
+
+        // Integer weights, e.g. counts.  The buckets are built in exact
+        // integer arithmetic: every outcome's segment is scaled by N so that
+        // each bucket has integer capacity m, the sum of the weights, and
+        // pairing splits the integer residues.  The table is therefore exact
+        // and identical on every compiler; only the final conversion of the
+        // thresholds to doubles rounds.  The weights must be unsigned, m
+        // must be positive and N * m must be less than 2^64.
+        template<typename UIntType, typename = typename std::enable_if<
+                   std::is_unsigned<UIntType>::value
+                   && !std::is_same<UIntType, bool>::value>::type>
+        param_type(const std::vector<UIntType>& weights) {
+          create_buckets_exact(std::vector<uint64_t>(weights.begin(),
+                                                     weights.end()));
+        }
+
+        // Sparse weights as (outcome, weight) pairs in any order, e.g. for a
+        // catalog whose ids are mostly unused.  Only outcomes with positive
+        // weight get buckets, so memory and construction time grow with
+        // their number rather than with the largest outcome, and samples are
+        // the given outcomes.  Weights of repeated outcomes are added.
+        param_type(const std::vector<std::pair<result_type, double>>& weights) {
+          std::vector<std::pair<result_type, double>> sorted;
+          sorted.reserve(weights.size());
+          for (const auto& weight : weights) {
+            if (weight.second > 0.0) sorted.push_back(weight);
+          }
+          std::sort(sorted.begin(), sorted.end());
+          for (const auto& weight : sorted) {
+            if (!outcomes_.empty() && outcomes_.back() == weight.first) {
+              probabilities_.back() += weight.second;
+            } else {
+              outcomes_.push_back(weight.first);
+              probabilities_.push_back(weight.second);
+            }
+          }
+          normalize_weights();
+          create_buckets();
+          if (outcomes_.empty()) return;
+          for (auto& bucket : buckets_) {
+            std::get<0>(bucket) = outcomes_[std::get<0>(bucket)];
+            std::get<1>(bucket) = outcomes_[std::get<1>(bucket)];
+          }
+        }
+
+        // Rebuilds the table from the weights in [first, last).  The
+        // probabilities, the buckets and the stacks that build them are
+        // rebuilt in their current storage, which is reallocated only if the
+        // number of outcomes grows beyond its capacity.
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last) {
+          outcomes_.clear();
+          probabilities_.assign(first, last);
+          normalize_weights();
+          create_buckets();
+        }
+
+        std::vector<double> probabilities() const {
+          return probabilities_;
+        }
+
+        // The outcomes of a sparse table in increasing order; empty for a
+        // dense table.  probabilities()[k] is the probability of outcomes()[k].
+        const std::vector<result_type>& outcomes() const {
+          return outcomes_;
+        }
+
+        // Exchanges the tables in O(1) time.
+        void swap(param_type& other) {
+          outcomes_.swap(other.outcomes_);
+          probabilities_.swap(other.probabilities_);
+          buckets_.swap(other.buckets_);
+          stacks_.data.swap(other.stacks_.data);
+        }
+
+        friend bool operator==(const param_type& a, const param_type& b) {
+          return a.outcomes_ == b.outcomes_
+                 && a.probabilities_ == b.probabilities_
+                 && a.buckets_ == b.buckets_;
+        }
+
+        friend bool operator!=(const param_type& a, const param_type& b) {
+          return !(a == b);
+        }
+
+      private:
+        friend class fast_discrete_distribution;
+
+        // Tables with 64-bit outcomes may have more buckets than a double
+        // indexes exactly, and near 1 a double cannot resolve the thresholds
+        // of 2^40 buckets.  The threshold of such a wide table is therefore
+        // relative to its bucket: bucket i maps fractions below the threshold
+        // to its first outcome.  Otherwise the threshold is absolute: bucket
+        // i maps uniform numbers u in [i/N, (i+1)/N) with u below the
+        // threshold to its first outcome.
+        static const bool kWide = sizeof(result_type) > sizeof(int32_t);
+
+        // Draws an outcome.  Tables with 32-bit outcomes map one uniform
+        // number to an outcome; see sample(double).  Wide tables draw the
+        // bucket with an exact uniform integer and the point inside the
+        // bucket with a separate uniform number, so that neither the index
+        // nor the threshold loses precision for N beyond 2^31.
+        template<typename URNG>
+        result_type sample(URNG& generator) const {
+          if (kWide) {
+            std::uniform_int_distribution<size_t> index_distribution(
+              0, buckets_.size() - 1);
+            const Bucket& bucket = buckets_[index_distribution(generator)];
+            const double fraction =
+              std::generate_canonical<double,
+                                      std::numeric_limits<double>::digits>(
+                generator);
+            return fraction < std::get<2>(bucket) ? std::get<0>(bucket)
+                                                  : std::get<1>(bucket);
+          }
+          std::uniform_real_distribution<double> uniform_distribution(0.0,
+                                                                      1.0);
+          return sample(uniform_distribution(generator));
+        }
+
+        // Maps a uniform number in [0,1) to an outcome of a table that is
+        // not wide.
+        result_type sample(const double number) const {
+          size_t index = floor(buckets_.size() * number);
+
+          // Fix index.  TODO: This probably not necessary?
+          if (index >= buckets_.size()) index = buckets_.size() - 1;
+
+          const Bucket& bucket = buckets_[index];
+          if (number < std::get<2>(bucket))
+            return std::get<0>(bucket);
+          else
+            return std::get<1>(bucket);
+        }
+
+        // Divides the weights stored in probabilities_ by their sum in place.
+        void normalize_weights() {
+          const double sum =
+            std::accumulate(probabilities_.begin(), probabilities_.end(), 0.0);
+          detail::divide(probabilities_.data(), sum, probabilities_.data(),
+                         probabilities_.size());
+        }
+
+        void create_buckets() {
+          const size_t N = probabilities_.size();
+          buckets_.clear();
+          if (N <= 0) {
+            buckets_.emplace_back(0, 0, 0.0);
+            return;
+          }
+          assert(N - 1 <= static_cast<size_t>(
+                            std::numeric_limits<result_type>::max()));
+
+          // Two stacks of outcomes in one vector.  First stack grows from the
+          // begining of the vector. The second stack grows from the end of the
+          // vector.
+          //
+          // The length of a segment is the probability of its outcome, except
+          // for the left-over segment of the last pairing.  That segment is
+          // pushed last and therefore popped in the next pairing, so its length
+          // is kept in a single variable instead of next to every outcome.
+          std::vector<result_type>& outcomes = stacks_.data;
+          outcomes.resize(N);
+          detail::stack_view<result_type,
+                             typename std::vector<result_type>::iterator>
+            small(outcomes.begin());
+          detail::stack_view<
+            result_type, typename std::vector<result_type>::reverse_iterator>
+            large(outcomes.rbegin());
+
+          // Split probabilities into small and large
+          for (size_t i = 0; i < N; ++i) {
+            if (probabilities_[i] < (1.0 / N)) {
+              small.push(static_cast<result_type>(i));
+            } else {
+              large.push(static_cast<result_type>(i));
+            }
+          }
+
+          buckets_.reserve(N);
+
+          // Outcome of the left-over segment and its length.  N means none.
+          size_t left_over_outcome = N;
+          double left_over_length = 0.0;
+          auto length = [&](const result_type outcome) {
+            return static_cast<size_t>(outcome) == left_over_outcome
+                   ? left_over_length : probabilities_[outcome];
+          };
+
+          size_t i = 0;
+          while (!small.empty() && !large.empty()) {
+            const result_type s = small.pop();
+            const result_type l = large.pop();
+            const double s_length = length(s);
+            const double l_length = length(l);
+
+            // Create a mixed bucket
+            buckets_.emplace_back(s, l,
+                                  kWide ? s_length * N
+                                        : s_length + static_cast<double>(i) / N);
+
+            // Calculate the length of the left-over segment
+            left_over_outcome = l;
+            left_over_length = s_length + l_length - static_cast<double>(1) / N;
+
+            // Re-insert the left-over segment
+            if (left_over_length < (1.0 / N))
+              small.push(l);
+            else
+              large.push(l);
+
+            ++i;
+          }
+
+          // Create pure buckets
+          while (!large.empty()) {
+            const result_type l = large.pop();
+            // The last argument is irrelevant as long it's not a NaN.
+            buckets_.emplace_back(l, l, 0.0);
+          }
+
+          // This loop can be executed only due to numerical inaccuracies.
+          // The left-over segment of the last large outcome can drop a few
+          // ulps below 1/N, e.g. for weights {1e-3, 1, 1e3, 1e6}.  verify()
+          // reports the resulting deviation.
+          while (!small.empty()) {
+            const result_type s = small.pop();
+            // The last argument is irrelevant as long it's not a NaN.
+            buckets_.emplace_back(s, s, 0.0);
+          }
+        }
+
+        void create_buckets_exact(const std::vector<uint64_t>& weights) {
+          const size_t N = weights.size();
+          probabilities_.clear();
+          buckets_.clear();
+          if (N <= 0) {
+            buckets_.emplace_back(0, 0, 0.0);
+            return;
+          }
+
+          // The sum must not wrap around before it is compared with the
+          // bound on N * m.
+          uint64_t m = 0;
+          for (auto weight : weights) {
+            assert(weight <= std::numeric_limits<uint64_t>::max() - m);
+            m += weight;
+          }
+          assert(m > 0);
+          assert(m <= std::numeric_limits<uint64_t>::max() / N);
+
+          probabilities_.reserve(N);
+          for (auto weight : weights) {
+            probabilities_.push_back(static_cast<double>(weight) / m);
+          }
+
+          std::vector<ExactSegment> segments(N);
+          detail::stack_view<ExactSegment, std::vector<ExactSegment>::iterator>
+            small(segments.begin());
+          detail::stack_view<ExactSegment,
+                             std::vector<ExactSegment>::reverse_iterator>
+            large(segments.rbegin());
+
+          // Outcome i covers a_i * N units of [0, N * m); bucket j covers
+          // [j * m, (j + 1) * m).
+          for (size_t i = 0; i < N; ++i) {
+            const uint64_t length = weights[i] * N;
+            if (length < m) {
+              small.push(ExactSegment(length, i));
+            } else {
+              large.push(ExactSegment(length, i));
+            }
+          }
+
+          buckets_.reserve(N);
+
+          const double total = static_cast<double>(m) * N;
+          uint64_t start = 0;
+          while (!small.empty() && !large.empty()) {
+            const ExactSegment s = small.pop();
+            const ExactSegment l = large.pop();
+
+            // Create a mixed bucket
+            buckets_.emplace_back(
+              s.second, l.second,
+              kWide ? static_cast<double>(s.first) / m
+                    : static_cast<double>(start + s.first) / total);
+
+            // The left-over segment is exact, so there is no rounding drift.
+            const uint64_t left_over = l.first - (m - s.first);
+            if (left_over < m)
+              small.push(ExactSegment(left_over, l.second));
+            else
+              large.push(ExactSegment(left_over, l.second));
+
+            start += m;
+          }
+
+          // In exact arithmetic every remaining segment has length exactly m,
+          // so at most one of the stacks is non-empty and all buckets are
+          // pure.
+          while (!large.empty()) {
+            const ExactSegment l = large.pop();
+            buckets_.emplace_back(l.second, l.second, 0.0);
+          }
+          while (!small.empty()) {
+            const ExactSegment s = small.pop();
+            buckets_.emplace_back(s.second, s.second, 0.0);
+          }
+        }
+
+        // Outcomes of a sparse table; see outcomes().
+        std::vector<result_type> outcomes_;
+
+        // List of probabilities
+        std::vector<double> probabilities_;
+        std::vector<Bucket> buckets_;
+
+        // Storage of the stacks of create_buckets().
+        detail::scratch_vector<result_type> stacks_;
+    };
+
+    fast_discrete_distribution(const std::vector<double>& weights)
+      : fast_discrete_distribution(param_type(weights)) { }
+
+    // See the corresponding constructor of param_type.
+    fast_discrete_distribution(std::vector<double>&& weights)
+      : fast_discrete_distribution(param_type(std::move(weights))) { }
+
+    // See the corresponding constructor of param_type.
+    template<typename InputIt, typename = typename
+               std::iterator_traits<InputIt>::iterator_category>
+    fast_discrete_distribution(InputIt first, InputIt last)
+      : fast_discrete_distribution(param_type(first, last)) { }
+
+    fast_discrete_distribution(std::initializer_list<double> weights)
+      : fast_discrete_distribution(param_type(weights)) { }
+
+    // See the corresponding constructor of param_type.
+    template<typename UnaryOperation>
+    fast_discrete_distribution(const size_t count, const double xmin,
+                               const double xmax, UnaryOperation fw)
+      : fast_discrete_distribution(param_type(count, xmin, xmax, fw)) { }
+
+    // Sparse weights; see the corresponding constructor of param_type.
+    fast_discrete_distribution(
+      const std::vector<std::pair<result_type, double>>& weights)
+      : fast_discrete_distribution(param_type(weights)) { }
+
+    // Integer weights; see the corresponding constructor of param_type.
+    template<typename UIntType, typename = typename std::enable_if<
+               std::is_unsigned<UIntType>::value
+               && !std::is_same<UIntType, bool>::value>::type>
+    fast_discrete_distribution(const std::vector<UIntType>& weights)
+      : fast_discrete_distribution(param_type(weights)) { }
+
+    explicit fast_discrete_distribution(const param_type& param)
+      : uniform_distribution_(0.0, 1.0),
+        param_(param),
+        prefetch_distance_(default_prefetch_distance(param_.buckets_.size())) {
+    }
+
+    explicit fast_discrete_distribution(param_type&& param)
+      : uniform_distribution_(0.0, 1.0),
+        param_(std::move(param)),
+        prefetch_distance_(default_prefetch_distance(param_.buckets_.size())) {
+    }
+
+    const param_type& param() const {
+      return param_;
+    }
+
+    // Copies the table of param into the storage already allocated.  Resets
+    // the prefetch distance to its default for the new table.
+    void param(const param_type& param) {
+      param_ = param;
+      prefetch_distance_ = default_prefetch_distance(param_.buckets_.size());
+    }
+
+    // Swaps the table of param in without copying.  param receives the
+    // previous table, so its storage can be reused by param.assign() for the
+    // next update.
+    void param(param_type&& param) {
+      param_.swap(param);
+      prefetch_distance_ = default_prefetch_distance(param_.buckets_.size());
+    }
+
+    result_type operator()(std::default_random_engine& generator) {
+      if (param_type::kWide) return param_.sample(generator);
+      return param_.sample(uniform_distribution_(generator));
+    }
+
+    // Draws a sample from the table of param instead of the own table, as
+    // the standard distributions do.  The distribution is not modified, so
+    // any number of threads can call this at the same time.
+    template<typename URNG>
+    result_type operator()(URNG& generator, const param_type& param) const {
+      return param.sample(generator);
+    }
+
+    // Fills [first, last) with samples.  Uniform numbers are drawn in blocks
+    // and mapped to outcomes by the vectorized kernel selected at run time
+    // (see fast_discrete_distribution_kernels.hpp).  Given the same generator
+    // state, the result is identical to calling operator() repeatedly.
+    //
+    // For tables larger than the cache every sample misses in the cache.  The
+    // uniform numbers are therefore drawn prefetch_distance() samples before
+    // they are mapped to outcomes, and the bucket of each is prefetched as
+    // soon as it is drawn, so that many misses are in flight at once.
+    //
+    // Wide tables (64-bit outcomes) have no vectorized kernel and are sampled
+    // one outcome at a time.
+    template<typename URNG>
+    void generate(URNG& generator, result_type* first, result_type* last) {
+      if (param_type::kWide) {
+        for (; first != last; ++first) *first = param_.sample(generator);
+        return;
+      }
+      const size_t block_size = 256;
+      double uniforms[block_size + kMaxPrefetchDistance];
+      const Bucket* buckets = param_.buckets_.data();
+      const size_t size = param_.buckets_.size();
+      const bool prefetch = prefetch_distance_ > 0 && size > 0;
+      // uniforms[0], ..., uniforms[drawn - 1] are drawn but not used yet.
+      size_t drawn = 0;
+      while (first < last) {
+        const size_t remaining = last - first;
+        const size_t n = std::min(block_size, remaining);
+        const size_t needed = std::min(n + prefetch_distance_, remaining);
+        for (; drawn < needed; ++drawn) {
+          uniforms[drawn] = uniform_distribution_(generator);
+          if (prefetch) {
+            size_t index = static_cast<size_t>(size * uniforms[drawn]);
+            if (index >= size) index = size - 1;
+            detail::prefetch(buckets + index);
+          }
+        }
+        detail::sample_buckets(buckets, size, uniforms, first, n);
+        std::copy(uniforms + n, uniforms + drawn, uniforms);
+        drawn -= n;
+        first += n;
+      }
+    }
+
+    // Largest value accepted by set_prefetch_distance().
+    static const size_t kMaxPrefetchDistance = 1024;
+
+    // Number of samples by which generate() prefetches ahead.  0 disables
+    // prefetching.  The constructors choose default_prefetch_distance().
+    size_t prefetch_distance() const {
+      return prefetch_distance_;
+    }
+
+    void set_prefetch_distance(const size_t distance) {
+      assert(distance <= kMaxPrefetchDistance);
+      prefetch_distance_ =
+        distance < kMaxPrefetchDistance ? distance : kMaxPrefetchDistance;
+    }
+
+    // Prefetching costs a few instructions per sample and only pays off once
+    // the table no longer fits into the last-level cache; 4 MiB is a small
+    // last-level cache.  Beyond that, a distance of 32 was the fastest in the
+    // benchmark sweep on x86-64.
+    static size_t default_prefetch_distance(const size_t num_buckets) {
+      return num_buckets * sizeof(Bucket) > (static_cast<size_t>(4) << 20)
+             ? 32 : 0;
+    }
+
+    result_type min() const {
+      if (!param_.outcomes_.empty()) return param_.outcomes_.front();
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      if (!param_.outcomes_.empty()) return param_.outcomes_.back();
+      return param_.probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(param_.probabilities_.size() - 1);
+    }
+
+    // For a sparse distribution, the probabilities of outcomes() only.
+    std::vector<double> probabilities() const {
+      return param_.probabilities_;
+    }
+
+    // See param_type::outcomes().
+    const std::vector<result_type>& outcomes() const {
+      return param_.outcomes_;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+    // Recomputes the probability of every outcome implied by the buckets and
+    // returns the maximum absolute deviation from probabilities().  Bucket i
+    // covers the interval [i/N, (i+1)/N); the part below the threshold (for
+    // wide tables, the fraction given by the threshold) belongs to the first
+    // outcome and the rest to the alias.  Runs in O(N) expected time.
+    //
+    // If num_threads > 1, the work is split in two passes.  In the first,
+    // every thread takes a range of buckets and sorts their masses by the
+    // thread that owns the outcome; in the second, every thread adds up the
+    // masses of its range of outcomes in bucket order.  Each mass is then
+    // summed in the same order as with one thread, so the result does not
+    // depend on num_threads.  The sorted masses take 32 extra bytes per
+    // outcome.
+    double verify(size_t num_threads = 1) const {
+      const size_t N = param_.probabilities_.size();
+      if (N == 0) return 0.0;
+      num_threads = std::max<size_t>(1, std::min(num_threads, N));
+
+      // The buckets of a sparse table hold outcomes, not positions in
+      // probabilities_.  A hash map built once maps them back in O(1)
+      // instead of a binary search of outcomes_ per bucket.
+      std::unordered_map<result_type, size_t> positions;
+      positions.reserve(param_.outcomes_.size());
+      for (size_t k = 0; k < param_.outcomes_.size(); ++k)
+        positions.emplace(param_.outcomes_[k], k);
+      auto index_of = [&](const result_type outcome) {
+        return positions.empty() ? static_cast<size_t>(outcome)
+                                 : positions.find(outcome)->second;
+      };
+
+      // Stores the outcomes and the masses of the two shares of bucket i.
+      auto shares_of = [&](const size_t i, size_t* k, double* m) {
+        const Bucket& bucket = param_.buckets_[i];
+        double first_mass;
+        double second_mass;
+        if (param_type::kWide) {
+          const double fraction =
+            std::min(std::max(std::get<2>(bucket), 0.0), 1.0);
+          first_mass = fraction / N;
+          second_mass = (1.0 - fraction) / N;
+        } else {
+          const double low = static_cast<double>(i) / N;
+          const double high = static_cast<double>(i + 1) / N;
+          const double threshold =
+            std::min(std::max(std::get<2>(bucket), low), high);
+          first_mass = threshold - low;
+          second_mass = high - threshold;
+        }
+        k[0] = index_of(std::get<0>(bucket));
+        k[1] = index_of(std::get<1>(bucket));
+        m[0] = first_mass;
+        m[1] = second_mass;
+      };
+
+      // Thread t owns buckets and outcomes [begin(t), begin(t + 1)).
+      auto begin = [&](const size_t t) { return N * t / num_threads; };
+      auto owner = [&](const size_t k) {
+        return ((k + 1) * num_threads - 1) / N;
+      };
+      auto run = [&](const std::function<void(size_t)>& work) {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; ++t)
+          threads.emplace_back(work, t);
+        for (auto& thread : threads) thread.join();
+      };
+
+      std::vector<double> mass(N, 0.0);
+      if (num_threads == 1) {
+        size_t k[2];
+        double m[2];
+        for (size_t i = 0; i < N; ++i) {
+          shares_of(i, k, m);
+          mass[k[0]] += m[0];
+          mass[k[1]] += m[1];
+        }
+      } else {
+        // shares[s][t] holds the shares of the buckets of thread s that
+        // belong to outcomes of thread t, in bucket order.
+        typedef std::vector<std::pair<size_t, double>> share_list;
+        std::vector<std::vector<share_list>> shares(
+          num_threads, std::vector<share_list>(num_threads));
+        run([&](const size_t s) {
+          // Alias tables send most shares of a bucket range to outcomes
+          // spread over the whole table.
+          const size_t count = begin(s + 1) - begin(s);
+          for (auto& list : shares[s])
+            list.reserve(2 * count / num_threads + 16);
+          size_t k[2];
+          double m[2];
+          for (size_t i = begin(s); i < begin(s + 1); ++i) {
+            shares_of(i, k, m);
+            shares[s][owner(k[0])].emplace_back(k[0], m[0]);
+            shares[s][owner(k[1])].emplace_back(k[1], m[1]);
+          }
+        });
+        run([&](const size_t t) {
+          for (size_t s = 0; s < num_threads; ++s) {
+            for (const auto& share : shares[s][t])
+              mass[share.first] += share.second;
+          }
+        });
+      }
+
+      double max_deviation = 0.0;
+      for (size_t k = 0; k < N; ++k) {
+        max_deviation = std::max(max_deviation,
+                                 std::fabs(mass[k] - param_.probabilities_[k]));
+      }
+      return max_deviation;
+    }
+
+    void PrintBuckets(std::ostream& out = std::cout) const {
+      out << "buckets.size() = " << param_.buckets_.size() << std::endl;
+      for (auto bucket : param_.buckets_) {
+        out << std::get<0>(bucket) << "  "
+            << std::get<1>(bucket) << "  "
+            << std::get<2>(bucket) << "  "
+            << std::endl;
+      }
+    }
+
+  private:
+    // Uniform distribution over interval [0,1].
+    std::uniform_real_distribution<double> uniform_distribution_;
+
+    // The probabilities and the bucket table.
+    param_type param_;
+
+    // See prefetch_distance().
+    size_t prefetch_distance_;
+};
+
+// Distribution with a fixed number N of outcomes.  The table lives inside the
+// object, so there is no heap allocation and no indirection, and for small N
+// it fits into one or two cache lines.  Bucket i always has outcome i as its
+// first outcome (Vose's layout), so a bucket is just a threshold and an alias.
+// All loops have the constant trip count N and are unrolled by the compiler.
+//
+// In C++17 and later the constructor is constexpr, so a distribution with
+// weights known at compile time can be declared
+//
+//   static constexpr fast_discrete_distribution<int, 4> d({1, 2, 3, 4});
+//
+// and its table is computed by the compiler and placed in read-only data.  To
+// make this possible the class holds no uniform distribution object; it draws
+// the uniform number with std::generate_canonical, which is what
+// std::uniform_real_distribution<double>(0.0, 1.0) does.
+template<typename IntType, size_t N>
+class fast_discrete_distribution {
+    static_assert(N > 0, "The support must not be empty.");
+
+  public:
+    typedef IntType result_type;
+
+    FDD_CONSTEXPR fast_discrete_distribution(
+        const std::array<double, N>& weights)
+      : thresholds_(), aliases_(), probabilities_() {
+      normalize_weights(weights);
+      create_buckets();
+    }
+
+    result_type operator()(std::default_random_engine& generator) const {
+      const double number =
+        std::generate_canonical<double, std::numeric_limits<double>::digits>(
+          generator);
+      size_t index = static_cast<size_t>(N * number);
+      if (index >= N) index = N - 1;
+      // Select without a branch; the comparison is unpredictable.
+      const result_type alias = aliases_[index];
+      const result_type below = number < thresholds_[index];
+      return alias + below * (static_cast<result_type>(index) - alias);
+    }
+
+    constexpr result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    constexpr result_type max() const {
+      return static_cast<result_type>(N - 1);
+    }
+
+    constexpr std::array<double, N> probabilities() const {
+      return probabilities_;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+  private:
+    FDD_CONSTEXPR void normalize_weights(const std::array<double, N>& weights) {
+      double sum = 0.0;
+      for (size_t i = 0; i < N; ++i) sum += weights[i];
+      for (size_t i = 0; i < N; ++i) probabilities_[i] = weights[i] / sum;
+    }
+
+    FDD_CONSTEXPR void create_buckets() {
+      // Lengths of the segments in units of 1/N.
+      std::array<double, N> lengths{};
+      for (size_t i = 0; i < N; ++i) lengths[i] = probabilities_[i] * N;
+
+      // Two stacks of outcomes in one array.  The small stack grows from the
+      // beginning, the large stack from the end.
+      std::array<size_t, N> stacks{};
+      size_t num_small = 0;
+      size_t num_large = 0;
+      for (size_t i = 0; i < N; ++i) {
+        if (lengths[i] < 1.0)
+          stacks[num_small++] = i;
+        else
+          stacks[N - 1 - num_large++] = i;
+      }
+
+      while (num_small > 0 && num_large > 0) {
+        const size_t s = stacks[--num_small];
+        const size_t l = stacks[N - num_large--];
+
+        // Bucket s: outcome s below the threshold, outcome l above it.
+        thresholds_[s] = (s + lengths[s]) / N;
+        aliases_[s] = static_cast<result_type>(l);
+
+        lengths[l] = (lengths[l] + lengths[s]) - 1.0;
+        if (lengths[l] < 1.0)
+          stacks[num_small++] = l;
+        else
+          stacks[N - 1 - num_large++] = l;
+      }
+
+      // Pure buckets.  Left-over small segments can only be due to rounding.
+      while (num_large > 0) make_pure(stacks[N - num_large--]);
+      while (num_small > 0) make_pure(stacks[--num_small]);
+    }
+
+    FDD_CONSTEXPR void make_pure(const size_t i) {
+      thresholds_[i] = 2.0;
+      aliases_[i] = static_cast<result_type>(i);
+    }
+
+    // Bucket i covers [i/N, (i+1)/N); numbers below thresholds_[i] map to
+    // outcome i and the others to aliases_[i].
+    std::array<double, N> thresholds_;
+    std::array<result_type, N> aliases_;
+
+    // List of probabilities
+    std::array<double, N> probabilities_;
+};
+
+#endif  // FAST_DISCRETE_DISTRIBUTION_HPP_
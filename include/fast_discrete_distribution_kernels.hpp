@@ -0,0 +1,504 @@
+// Bulk sampling and normalization kernels with runtime CPU dispatch.
+//
+// Every kernel is compiled in several variants, one per instruction set.  The
+// variant is chosen by cpuid when a kernel is used for the first time and can
+// be overridden by force_kernel_isa() or by setting the environment variable
+// FDD_KERNEL_ISA to "generic", "sse2", "avx2" or "avx512" before the first
+// use.  All variants produce bit-identical results.
+
+#ifndef FAST_DISCRETE_DISTRIBUTION_KERNELS_HPP_
+#define FAST_DISCRETE_DISTRIBUTION_KERNELS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FDD_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define FDD_X86_KERNELS 0
+#endif
+
+enum class kernel_isa { generic, sse2, avx2, avx512 };
+
+inline const char* kernel_isa_name(const kernel_isa isa) {
+  switch (isa) {
+    case kernel_isa::sse2: return "sse2";
+    case kernel_isa::avx2: return "avx2";
+    case kernel_isa::avx512: return "avx512";
+    default: return "generic";
+  }
+}
+
+// Returns true if the CPU and the operating system support the variant.
+inline bool kernel_isa_supported(const kernel_isa isa) {
+#if FDD_X86_KERNELS
+  switch (isa) {
+    case kernel_isa::generic: return true;
+    case kernel_isa::sse2: return __builtin_cpu_supports("sse2");
+    case kernel_isa::avx2: return __builtin_cpu_supports("avx2");
+    case kernel_isa::avx512:
+      return __builtin_cpu_supports("avx512f")
+             && __builtin_cpu_supports("avx512vl");
+  }
+  return false;
+#else
+  return isa == kernel_isa::generic;
+#endif
+}
+
+// The best variant supported by the CPU.
+inline kernel_isa detect_kernel_isa() {
+  const kernel_isa preference[] = {
+    kernel_isa::avx512, kernel_isa::avx2, kernel_isa::sse2
+  };
+  for (const kernel_isa isa : preference) {
+    if (kernel_isa_supported(isa)) return isa;
+  }
+  return kernel_isa::generic;
+}
+
+namespace detail {
+inline std::atomic<kernel_isa>& active_kernel_isa_storage() {
+  static std::atomic<kernel_isa> isa([]() {
+    const char* name = std::getenv("FDD_KERNEL_ISA");
+    const kernel_isa all[] = {
+      kernel_isa::generic, kernel_isa::sse2, kernel_isa::avx2,
+      kernel_isa::avx512
+    };
+    for (const kernel_isa candidate : all) {
+      if (name != nullptr && std::strcmp(name, kernel_isa_name(candidate)) == 0
+          && kernel_isa_supported(candidate))
+        return candidate;
+    }
+    return detect_kernel_isa();
+  }());
+  return isa;
+}
+}  // namespace detail
+
+// The variant used by the kernels.
+inline kernel_isa active_kernel_isa() {
+  return detail::active_kernel_isa_storage().load(std::memory_order_relaxed);
+}
+
+// Makes the kernels use the given variant.  Intended for testing and
+// benchmarking.  Returns false and leaves the variant unchanged if the CPU does
+// not support it.
+inline bool force_kernel_isa(const kernel_isa isa) {
+  if (!kernel_isa_supported(isa)) return false;
+  detail::active_kernel_isa_storage().store(isa, std::memory_order_relaxed);
+  return true;
+}
+
+namespace detail {
+
+// Asks the CPU to start loading the cache line containing address.
+inline void prefetch(const void* address) {
+#if defined(__GNUC__)
+  __builtin_prefetch(address);
+#else
+  (void) address;
+#endif
+}
+
+// Memory layout of a bucket: a threshold and two outcomes at fixed byte
+// offsets from the start of the bucket.
+struct bucket_layout {
+  const char* base;
+  size_t stride;
+  size_t threshold_offset;
+  size_t first_offset;
+  size_t second_offset;
+  size_t size;
+};
+
+// Portable kernel.  Maps every uniform number u in [0,1) to the outcome
+// selected by bucket floor(u * size), exactly like
+// fast_discrete_distribution::operator().
+template<typename Bucket, typename IntType>
+void sample_buckets_generic(const Bucket* buckets, const size_t size,
+                            const double* uniforms, IntType* out,
+                            const size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    size_t index = static_cast<size_t>(size * uniforms[i]);
+    if (index >= size) index = size - 1;
+    const Bucket& bucket = buckets[index];
+    out[i] = uniforms[i] < std::get<2>(bucket)
+             ? std::get<0>(bucket) : std::get<1>(bucket);
+  }
+}
+
+// Bucket of a table in Vose's layout with a threshold relative to the bucket,
+// as used by float_discrete_distribution.  Bucket k maps fractions below
+// threshold to outcome k and the others to alias.
+template<typename RealType, typename IntType>
+struct vose_bucket {
+  RealType threshold;
+  IntType alias;
+};
+
+// Portable kernel for vose_bucket tables.
+template<typename RealType, typename IntType>
+void sample_vose_generic(const vose_bucket<RealType, IntType>* buckets,
+                         const size_t size, const double* uniforms,
+                         IntType* out, const size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const double scaled = size * uniforms[i];
+    size_t index = static_cast<size_t>(scaled);
+    if (index >= size) index = size - 1;
+    out[i] = scaled - index < buckets[index].threshold
+             ? static_cast<IntType>(index) : buckets[index].alias;
+  }
+}
+
+#if FDD_X86_KERNELS
+
+inline int32_t load_int32(const char* address) {
+  int32_t value;
+  std::memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+inline double load_double(const char* address) {
+  double value;
+  std::memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+// Scalar tail shared by the vector kernels.
+inline void sample_buckets_tail(const bucket_layout& layout,
+                                const double* uniforms, int32_t* out,
+                                size_t i, const size_t n) {
+  for (; i < n; ++i) {
+    size_t index = static_cast<size_t>(layout.size * uniforms[i]);
+    if (index >= layout.size) index = layout.size - 1;
+    const char* bucket = layout.base + index * layout.stride;
+    out[i] = uniforms[i] < load_double(bucket + layout.threshold_offset)
+             ? load_int32(bucket + layout.first_offset)
+             : load_int32(bucket + layout.second_offset);
+  }
+}
+
+// Computes two bucket indices at a time with SSE2 and loads the buckets with
+// scalar loads.
+__attribute__((target("sse2")))
+inline void sample_buckets_sse2(const bucket_layout& layout,
+                                const double* uniforms, int32_t* out,
+                                const size_t n) {
+  const __m128d size = _mm_set1_pd(static_cast<double>(layout.size));
+  const int32_t last = static_cast<int32_t>(layout.size - 1);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    const __m128d u = _mm_loadu_pd(uniforms + i);
+    int32_t indices[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices),
+                     _mm_cvttpd_epi32(_mm_mul_pd(u, size)));
+    for (size_t j = 0; j < 2; ++j) {
+      const int32_t index = indices[j] < last ? indices[j] : last;
+      const char* bucket = layout.base + index * layout.stride;
+      out[i + j] = uniforms[i + j] < load_double(bucket + layout.threshold_offset)
+                   ? load_int32(bucket + layout.first_offset)
+                   : load_int32(bucket + layout.second_offset);
+    }
+  }
+  sample_buckets_tail(layout, uniforms, out, i, n);
+}
+
+// Four samples at a time using gathers.
+__attribute__((target("avx2")))
+inline void sample_buckets_avx2(const bucket_layout& layout,
+                                const double* uniforms, int32_t* out,
+                                const size_t n) {
+  const __m256d size = _mm256_set1_pd(static_cast<double>(layout.size));
+  const __m128i last = _mm_set1_epi32(static_cast<int32_t>(layout.size - 1));
+  const __m256i stride = _mm256_set1_epi64x(static_cast<long long>(layout.stride));
+  const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  const double* thresholds =
+    reinterpret_cast<const double*>(layout.base + layout.threshold_offset);
+  const int* firsts =
+    reinterpret_cast<const int*>(layout.base + layout.first_offset);
+  const int* seconds =
+    reinterpret_cast<const int*>(layout.base + layout.second_offset);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256d u = _mm256_loadu_pd(uniforms + i);
+    const __m128i index =
+      _mm_min_epi32(_mm256_cvttpd_epi32(_mm256_mul_pd(u, size)), last);
+    const __m256i offset = _mm256_mul_epu32(_mm256_cvtepi32_epi64(index), stride);
+    const __m256d threshold = _mm256_i64gather_pd(thresholds, offset, 1);
+    const __m128i first = _mm256_i64gather_epi32(firsts, offset, 1);
+    const __m128i second = _mm256_i64gather_epi32(seconds, offset, 1);
+    const __m256i below = _mm256_castpd_si256(_mm256_cmp_pd(u, threshold, _CMP_LT_OQ));
+    const __m128i mask =
+      _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(below, low_halves));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_blendv_epi8(second, first, mask));
+  }
+  sample_buckets_tail(layout, uniforms, out, i, n);
+}
+
+// GCC 12 reports the undefined source operands used inside the AVX-512
+// intrinsics as possibly uninitialized.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Eight samples at a time using gathers and mask registers.
+__attribute__((target("avx512f,avx512vl")))
+inline void sample_buckets_avx512(const bucket_layout& layout,
+                                  const double* uniforms, int32_t* out,
+                                  const size_t n) {
+  const __m512d size = _mm512_set1_pd(static_cast<double>(layout.size));
+  const __m256i last = _mm256_set1_epi32(static_cast<int32_t>(layout.size - 1));
+  const __m512i stride = _mm512_set1_epi64(static_cast<long long>(layout.stride));
+  const char* thresholds = layout.base + layout.threshold_offset;
+  const char* firsts = layout.base + layout.first_offset;
+  const char* seconds = layout.base + layout.second_offset;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512d u = _mm512_loadu_pd(uniforms + i);
+    const __m256i index =
+      _mm256_min_epi32(_mm512_cvttpd_epi32(_mm512_mul_pd(u, size)), last);
+    const __m512i offset = _mm512_mul_epu32(_mm512_cvtepi32_epi64(index), stride);
+    const __m512d threshold = _mm512_i64gather_pd(offset, thresholds, 1);
+    const __m256i first = _mm512_i64gather_epi32(offset, firsts, 1);
+    const __m256i second = _mm512_i64gather_epi32(offset, seconds, 1);
+    const __mmask8 below = _mm512_cmp_pd_mask(u, threshold, _CMP_LT_OQ);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_mask_blend_epi32(below, second, first));
+  }
+  sample_buckets_tail(layout, uniforms, out, i, n);
+}
+
+// Eight samples at a time from a table of 8-byte buckets with float
+// thresholds.  The uniform numbers stay doubles, so the fraction inside the
+// bucket keeps 53 - log2(size) bits; only the 32-bit thresholds and aliases
+// are gathered.
+__attribute__((target("avx512f,avx512vl")))
+inline void sample_vose_avx512(const vose_bucket<float, int32_t>* buckets,
+                               const size_t size, const double* uniforms,
+                               int32_t* out, const size_t n) {
+  const float* thresholds = &buckets[0].threshold;
+  const int32_t* aliases = &buckets[0].alias;
+  const __m512d scale = _mm512_set1_pd(static_cast<double>(size));
+  const __m256i last = _mm256_set1_epi32(static_cast<int32_t>(size - 1));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m512d scaled = _mm512_mul_pd(_mm512_loadu_pd(uniforms + i), scale);
+    const __m256i index =
+      _mm256_min_epi32(_mm512_cvttpd_epi32(scaled), last);
+    const __m512d fraction =
+      _mm512_sub_pd(scaled, _mm512_cvtepi32_pd(index));
+    const __m512d threshold =
+      _mm512_cvtps_pd(_mm256_i32gather_ps(thresholds, index, 8));
+    const __m256i alias = _mm256_i32gather_epi32(aliases, index, 8);
+    const __mmask8 below = _mm512_cmp_pd_mask(fraction, threshold, _CMP_LT_OQ);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_mask_blend_epi32(below, alias, index));
+  }
+  sample_vose_generic(buckets, size, uniforms + i, out + i, n - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Four samples at a time; see sample_vose_avx512().
+__attribute__((target("avx2")))
+inline void sample_vose_avx2(const vose_bucket<float, int32_t>* buckets,
+                             const size_t size, const double* uniforms,
+                             int32_t* out, const size_t n) {
+  const float* thresholds = &buckets[0].threshold;
+  const int32_t* aliases = &buckets[0].alias;
+  const __m256d scale = _mm256_set1_pd(static_cast<double>(size));
+  const __m128i last = _mm_set1_epi32(static_cast<int32_t>(size - 1));
+  const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256d scaled = _mm256_mul_pd(_mm256_loadu_pd(uniforms + i), scale);
+    const __m128i index = _mm_min_epi32(_mm256_cvttpd_epi32(scaled), last);
+    const __m256d fraction =
+      _mm256_sub_pd(scaled, _mm256_cvtepi32_pd(index));
+    const __m256d threshold =
+      _mm256_cvtps_pd(_mm_i32gather_ps(thresholds, index, 8));
+    const __m128i alias = _mm_i32gather_epi32(aliases, index, 8);
+    const __m256i below =
+      _mm256_castpd_si256(_mm256_cmp_pd(fraction, threshold, _CMP_LT_OQ));
+    const __m128i mask =
+      _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(below, low_halves));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_blendv_epi8(alias, index, mask));
+  }
+  sample_vose_generic(buckets, size, uniforms + i, out + i, n - i);
+}
+
+__attribute__((target("sse2")))
+inline void divide_sse2(const double* in, const double divisor, double* out,
+                        const size_t n) {
+  const __m128d d = _mm_set1_pd(divisor);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    _mm_storeu_pd(out + i, _mm_div_pd(_mm_loadu_pd(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+__attribute__((target("avx2")))
+inline void divide_avx2(const double* in, const double divisor, double* out,
+                        const size_t n) {
+  const __m256d d = _mm256_set1_pd(divisor);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+__attribute__((target("avx512f")))
+inline void divide_avx512(const double* in, const double divisor, double* out,
+                          const size_t n) {
+  const __m512d d = _mm512_set1_pd(divisor);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm512_storeu_pd(out + i, _mm512_div_pd(_mm512_loadu_pd(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+__attribute__((target("sse2")))
+inline void divide_sse2(const float* in, const float divisor, float* out,
+                        const size_t n) {
+  const __m128 d = _mm_set1_ps(divisor);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(out + i, _mm_div_ps(_mm_loadu_ps(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+__attribute__((target("avx2")))
+inline void divide_avx2(const float* in, const float divisor, float* out,
+                        const size_t n) {
+  const __m256 d = _mm256_set1_ps(divisor);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_loadu_ps(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+__attribute__((target("avx512f")))
+inline void divide_avx512(const float* in, const float divisor, float* out,
+                          const size_t n) {
+  const __m512 d = _mm512_set1_ps(divisor);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, _mm512_div_ps(_mm512_loadu_ps(in + i), d));
+  for (; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+#endif  // FDD_X86_KERNELS
+
+// Samples n outcomes from the buckets, one for each uniform number.  The
+// vector variants require 32-bit outcomes and fewer than 2^30 buckets, so that
+// the scaled index always fits into a 32-bit lane; other tables use the
+// portable kernel.
+template<typename Bucket, typename IntType>
+void sample_buckets(const Bucket* buckets, const size_t size,
+                    const double* uniforms, IntType* out, const size_t n) {
+#if FDD_X86_KERNELS
+  const kernel_isa isa = active_kernel_isa();
+  if (isa != kernel_isa::generic && sizeof(IntType) == sizeof(int32_t)
+      && size < (static_cast<size_t>(1) << 30)) {
+    const char* base = reinterpret_cast<const char*>(buckets);
+    const bucket_layout layout = {
+      base,
+      sizeof(Bucket),
+      static_cast<size_t>(
+        reinterpret_cast<const char*>(&std::get<2>(buckets[0])) - base),
+      static_cast<size_t>(
+        reinterpret_cast<const char*>(&std::get<0>(buckets[0])) - base),
+      static_cast<size_t>(
+        reinterpret_cast<const char*>(&std::get<1>(buckets[0])) - base),
+      size
+    };
+    int32_t* out32 = reinterpret_cast<int32_t*>(out);
+    switch (isa) {
+      case kernel_isa::avx512:
+        sample_buckets_avx512(layout, uniforms, out32, n);
+        return;
+      case kernel_isa::avx2:
+        sample_buckets_avx2(layout, uniforms, out32, n);
+        return;
+      default:
+        sample_buckets_sse2(layout, uniforms, out32, n);
+        return;
+    }
+  }
+#endif
+  sample_buckets_generic(buckets, size, uniforms, out, n);
+}
+
+// Samples n outcomes from a vose_bucket table, one for each uniform number.
+// The vector variants require float thresholds, 32-bit outcomes and fewer
+// than 2^30 buckets; the sse2 variant and all other tables use the portable
+// kernel.
+template<typename RealType, typename IntType>
+void sample_vose(const vose_bucket<RealType, IntType>* buckets,
+                 const size_t size, const double* uniforms, IntType* out,
+                 const size_t n) {
+#if FDD_X86_KERNELS
+  if (std::is_same<RealType, float>::value
+      && sizeof(IntType) == sizeof(int32_t)
+      && size < (static_cast<size_t>(1) << 30)) {
+    const vose_bucket<float, int32_t>* buckets32 =
+      reinterpret_cast<const vose_bucket<float, int32_t>*>(buckets);
+    int32_t* out32 = reinterpret_cast<int32_t*>(out);
+    switch (active_kernel_isa()) {
+      case kernel_isa::avx512:
+        sample_vose_avx512(buckets32, size, uniforms, out32, n);
+        return;
+      case kernel_isa::avx2:
+        sample_vose_avx2(buckets32, size, uniforms, out32, n);
+        return;
+      default:
+        break;
+    }
+  }
+#endif
+  sample_vose_generic(buckets, size, uniforms, out, n);
+}
+
+// Computes out[i] = in[i] / divisor.  Division is correctly rounded, so all
+// variants agree bit for bit.  in and out may be the same array.
+inline void divide(const double* in, const double divisor, double* out,
+                   const size_t n) {
+#if FDD_X86_KERNELS
+  switch (active_kernel_isa()) {
+    case kernel_isa::avx512: divide_avx512(in, divisor, out, n); return;
+    case kernel_isa::avx2: divide_avx2(in, divisor, out, n); return;
+    case kernel_isa::sse2: divide_sse2(in, divisor, out, n); return;
+    default: break;
+  }
+#endif
+  for (size_t i = 0; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+// Single-precision version, twice as many lanes per instruction.
+inline void divide(const float* in, const float divisor, float* out,
+                   const size_t n) {
+#if FDD_X86_KERNELS
+  switch (active_kernel_isa()) {
+    case kernel_isa::avx512: divide_avx512(in, divisor, out, n); return;
+    case kernel_isa::avx2: divide_avx2(in, divisor, out, n); return;
+    case kernel_isa::sse2: divide_sse2(in, divisor, out, n); return;
+    default: break;
+  }
+#endif
+  for (size_t i = 0; i < n; ++i) out[i] = in[i] / divisor;
+}
+
+}  // namespace detail
+
+#endif  // FAST_DISCRETE_DISTRIBUTION_KERNELS_HPP_
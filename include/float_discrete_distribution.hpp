@@ -0,0 +1,244 @@
+// Discrete distribution with a single-precision alias table.
+//
+// fast_discrete_distribution<int> stores a double probability and a 16-byte
+// bucket per outcome.  float_discrete_distribution<IntType, float> stores the
+// probability, the threshold and the alias in 4 bytes each, 12 bytes per
+// outcome, and normalizes the weights with twice as many SIMD lanes.  The
+// table uses Vose's layout, so a bucket is a threshold and an alias, 8 bytes,
+// and the bulk kernel gathers 32-bit values (see
+// fast_discrete_distribution_kernels.hpp).  With RealType = double the same
+// layout is used in double precision.
+//
+// The threshold of a bucket is relative to the bucket: bucket k maps
+// fractions below its threshold to outcome k and the others to its alias.
+// An absolute threshold in [0,1), as fast_discrete_distribution uses, would
+// not resolve 1/N in single precision for N beyond a few thousand.  The
+// uniform numbers are doubles, so the bucket index and the fraction inside
+// the bucket are as precise as in double mode.
+//
+// Accuracy with RealType = float.  Storing the probabilities in float changes
+// each of them by a relative error of at most 2^-22 (three float roundings).
+// The table realizes the stored probabilities, renormalized in double
+// precision, except that every threshold is rounded to float: every bucket
+// moves at most 2^-25 / N of probability between its two outcomes.  The total
+// variation distance to the stored probabilities is therefore at most about
+// 2^-23, and the probability of an outcome occupying c buckets is off by at
+// most 2^-22 p + c 2^-25 / N.  verify() measures the deviation.  Construction
+// pairs the segments in double precision, so the heavy outcomes of skewed
+// distributions do not accumulate float rounding errors.
+
+#ifndef FLOAT_DISCRETE_DISTRIBUTION_HPP_
+#define FLOAT_DISCRETE_DISTRIBUTION_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "fast_discrete_distribution_kernels.hpp"
+
+template<typename IntType = int, typename RealType = float>
+class float_discrete_distribution {
+    static_assert(std::is_floating_point<RealType>::value,
+                  "RealType must be float or double.");
+
+  public:
+    typedef IntType result_type;
+    typedef RealType real_type;
+
+    float_discrete_distribution(const std::vector<double>& weights)
+      : float_discrete_distribution(weights.begin(), weights.end()) { }
+
+    // Weights from any range, e.g. a vector<float>.  The weights are read
+    // once, directly into the storage of the probabilities.
+    template<typename InputIt, typename = typename
+               std::iterator_traits<InputIt>::iterator_category>
+    float_discrete_distribution(InputIt first, InputIt last)
+      : uniform_distribution_(0.0, 1.0), probabilities_(first, last) {
+      normalize_weights();
+      create_buckets();
+    }
+
+    template<typename URNG>
+    result_type operator()(URNG& generator) {
+      const size_t N = buckets_.size();
+      if (N == 0) return static_cast<result_type>(0);
+      const double scaled = N * uniform_distribution_(generator);
+      size_t index = static_cast<size_t>(scaled);
+      if (index >= N) index = N - 1;
+      return scaled - index < buckets_[index].threshold
+             ? static_cast<result_type>(index) : buckets_[index].alias;
+    }
+
+    // Fills [first, last) with samples.  Given the same generator state, the
+    // result is identical to calling operator() repeatedly.  As in
+    // fast_discrete_distribution::generate(), tables larger than 4 MiB draw
+    // the uniform numbers kPrefetchDistance samples ahead and prefetch their
+    // buckets.
+    template<typename URNG>
+    void generate(URNG& generator, result_type* first, result_type* last) {
+      const size_t size = buckets_.size();
+      if (size == 0) {
+        std::fill(first, last, static_cast<result_type>(0));
+        return;
+      }
+      const size_t block_size = 256;
+      double uniforms[block_size + kPrefetchDistance];
+      const size_t distance =
+        size * sizeof(bucket) > (static_cast<size_t>(4) << 20)
+        ? kPrefetchDistance : 0;
+      // uniforms[0], ..., uniforms[drawn - 1] are drawn but not used yet.
+      size_t drawn = 0;
+      while (first < last) {
+        const size_t remaining = last - first;
+        const size_t n = std::min(block_size, remaining);
+        const size_t needed = std::min(n + distance, remaining);
+        for (; drawn < needed; ++drawn) {
+          uniforms[drawn] = uniform_distribution_(generator);
+          if (distance > 0) {
+            size_t index = static_cast<size_t>(size * uniforms[drawn]);
+            if (index >= size) index = size - 1;
+            detail::prefetch(&buckets_[index]);
+          }
+        }
+        detail::sample_vose(buckets_.data(), size, uniforms, first, n);
+        std::copy(uniforms + n, uniforms + drawn, uniforms);
+        drawn -= n;
+        first += n;
+      }
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(probabilities_.size() - 1);
+    }
+
+    std::vector<RealType> probabilities() const {
+      return probabilities_;
+    }
+
+    void reset() {
+      // Empty
+    }
+
+    // Recomputes the probability of every outcome implied by the table in
+    // double precision and returns the maximum absolute deviation from
+    // probabilities().  Runs in O(N) time.
+    double verify() const {
+      const size_t N = buckets_.size();
+      std::vector<double> mass(N, 0.0);
+      for (size_t k = 0; k < N; ++k) {
+        const double fraction = std::min(
+          std::max(static_cast<double>(buckets_[k].threshold), 0.0), 1.0);
+        mass[k] += fraction / N;
+        mass[buckets_[k].alias] += (1.0 - fraction) / N;
+      }
+      double max_deviation = 0.0;
+      for (size_t k = 0; k < N; ++k) {
+        max_deviation = std::max(max_deviation,
+                                 std::fabs(mass[k] - probabilities_[k]));
+      }
+      return max_deviation;
+    }
+
+  private:
+    typedef detail::vose_bucket<RealType, result_type> bucket;
+
+    // Samples by which generate() prefetches ahead on large tables, the
+    // default of fast_discrete_distribution.
+    static const size_t kPrefetchDistance = 32;
+
+    // The sum is accumulated in double precision, so that large supports do
+    // not lose the small weights.
+    void normalize_weights() {
+      double sum = 0.0;
+      for (auto weight : probabilities_) sum += weight;
+      detail::divide(probabilities_.data(), static_cast<RealType>(sum),
+                     probabilities_.data(), probabilities_.size());
+    }
+
+    void create_buckets() {
+      const size_t N = probabilities_.size();
+      buckets_.resize(N);
+      if (N == 0) return;
+      assert(N - 1 <= static_cast<size_t>(
+                        std::numeric_limits<result_type>::max()));
+
+      // Lengths of the segments in units of a bucket.  The rounded
+      // probabilities do not add up to exactly 1, so they are scaled by
+      // N over their sum.  As in fast_discrete_distribution, only the
+      // left-over segment of the last pairing has a length other than its
+      // scaled probability; it is kept in a double.
+      double sum = 0.0;
+      for (auto probability : probabilities_) sum += probability;
+      const double scale = N / sum;
+      size_t left_over_outcome = N;
+      double left_over_length = 0.0;
+      auto length = [&](const size_t outcome) {
+        return outcome == left_over_outcome
+               ? left_over_length : probabilities_[outcome] * scale;
+      };
+
+      // Two stacks of outcomes in one vector.  The small stack grows from the
+      // beginning, the large stack from the end.
+      std::vector<result_type> stacks(N);
+      size_t num_small = 0;
+      size_t num_large = 0;
+      for (size_t i = 0; i < N; ++i) {
+        if (length(i) < 1.0)
+          stacks[num_small++] = static_cast<result_type>(i);
+        else
+          stacks[N - 1 - num_large++] = static_cast<result_type>(i);
+      }
+
+      while (num_small > 0 && num_large > 0) {
+        const size_t s = stacks[--num_small];
+        const size_t l = stacks[N - num_large--];
+        const double s_length = length(s);
+        const double l_length = length(l);
+
+        buckets_[s].threshold = static_cast<RealType>(s_length);
+        buckets_[s].alias = static_cast<result_type>(l);
+
+        left_over_outcome = l;
+        left_over_length = (l_length + s_length) - 1.0;
+        if (left_over_length < 1.0)
+          stacks[num_small++] = static_cast<result_type>(l);
+        else
+          stacks[N - 1 - num_large++] = static_cast<result_type>(l);
+      }
+
+      // Pure buckets.  Left-over small segments can only be due to rounding.
+      while (num_large > 0) make_pure(stacks[N - num_large--]);
+      while (num_small > 0) make_pure(stacks[--num_small]);
+    }
+
+    void make_pure(const size_t k) {
+      buckets_[k].threshold = static_cast<RealType>(2.0);
+      buckets_[k].alias = static_cast<result_type>(k);
+    }
+
+    // Uniform distribution over interval [0,1].
+    std::uniform_real_distribution<double> uniform_distribution_;
+
+    // List of probabilities
+    std::vector<RealType> probabilities_;
+
+    std::vector<bucket> buckets_;
+};
+
+template<typename IntType, typename RealType>
+const size_t float_discrete_distribution<IntType, RealType>::kPrefetchDistance;
+
+#endif  // FLOAT_DISCRETE_DISTRIBUTION_HPP_
@@ -0,0 +1,242 @@
+// Discrete distribution sampled by a discrete distribution generating (DDG)
+// tree, consuming random bits one at a time.
+//
+// The sampler is the entropy-optimal sampler of Knuth and Yao.  The weights
+// are integers a_0, ..., a_{n-1} with sum m, and level j = 1, 2, ... of the
+// tree has one leaf for every outcome i whose probability a_i / m has bit j
+// set in its binary expansion.  A sample walks down the tree one random bit
+// at a time until it reaches a leaf.  Every outcome i is generated with
+// probability exactly a_i / m, and the expected number of bits consumed is
+// at least H and less than H + 2, where H is the entropy of the distribution,
+// which no sampler that reads fair bits can beat.  By contrast, operator() of
+// fast_discrete_distribution consumes a whole double per sample.  (The Fast
+// Loaded Dice Roller pads m to a power of two with a reject outcome instead,
+// which keeps the tree finite but costs up to 6 bits per sample.)
+//
+// Unless m is a power of two, the expansions are infinite.  The tree is
+// stored down to level k + 32, where k is the smallest integer with
+// 2^k >= m, and walks that go deeper, with probability less than 2^-32,
+// continue from the stored remainders of the expansions.  Memory is
+// O(n k), so this sampler suits distributions where random bits are
+// expensive rather than very large distributions.
+
+#ifndef KNUTH_YAO_DISCRETE_DISTRIBUTION_HPP_
+#define KNUTH_YAO_DISCRETE_DISTRIBUTION_HPP_
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Hands out the bits of 64-bit words drawn from a generator one at a time and
+// counts the bits handed out.
+class random_bit_buffer {
+  public:
+    random_bit_buffer() : word_(0), available_(0), consumed_(0) { }
+
+    template<typename URNG>
+    unsigned next(URNG& generator) {
+      if (available_ == 0) {
+        word_ = words_(generator);
+        available_ = 64;
+      }
+      const unsigned bit = static_cast<unsigned>(word_ & 1);
+      word_ >>= 1;
+      --available_;
+      ++consumed_;
+      return bit;
+    }
+
+    // Number of bits handed out so far.
+    uint64_t consumed() const {
+      return consumed_;
+    }
+
+    // Discards the buffered bits.
+    void reset() {
+      word_ = 0;
+      available_ = 0;
+    }
+
+  private:
+    std::uniform_int_distribution<uint64_t> words_;
+    uint64_t word_;
+    unsigned available_;
+    uint64_t consumed_;
+};
+
+template<typename IntType = int>
+class knuth_yao_discrete_distribution {
+  public:
+    typedef IntType result_type;
+
+    // Real weights are rounded to integers that sum to about 2^precision.
+    // Every positive weight is rounded to at least 1, so no outcome is lost.
+    // The probability of each outcome is then exact up to about 2^-precision.
+    // precision must be at most 62.
+    knuth_yao_discrete_distribution(const std::vector<double>& weights,
+                                    const unsigned precision = 32) {
+      assert(precision <= 62);
+      const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+      const double scale = std::ldexp(1.0, precision);
+      std::vector<uint64_t> integer_weights;
+      integer_weights.reserve(weights.size());
+      for (auto weight : weights) {
+        uint64_t integer_weight =
+          sum > 0.0 ? static_cast<uint64_t>(std::llround(weight / sum * scale))
+                    : 0;
+        if (integer_weight == 0 && weight > 0.0) integer_weight = 1;
+        integer_weights.push_back(integer_weight);
+      }
+      create_tree(integer_weights);
+    }
+
+    // Integer weights are used exactly.  Their sum must be less than 2^63.
+    template<typename UIntType, typename = typename std::enable_if<
+               std::is_unsigned<UIntType>::value
+               && !std::is_same<UIntType, bool>::value>::type>
+    knuth_yao_discrete_distribution(const std::vector<UIntType>& weights) {
+      create_tree(std::vector<uint64_t>(weights.begin(), weights.end()));
+    }
+
+    template<typename URNG>
+    result_type operator()(URNG& generator) {
+      if (leaves_.empty()) return static_cast<result_type>(certain_outcome_);
+
+      // d is the position of the current node among the internal nodes of
+      // its level.
+      size_t d = 0;
+      for (size_t level = 0; level + 1 < offsets_.size(); ++level) {
+        d = 2 * d + (1 - bits_.next(generator));
+        const size_t num_leaves = offsets_[level + 1] - offsets_[level];
+        if (d < num_leaves)
+          return static_cast<result_type>(leaves_[offsets_[level] + d]);
+        d -= num_leaves;
+      }
+      return continue_walk(generator, d);
+    }
+
+    result_type min() const {
+      return static_cast<result_type>(0);
+    }
+
+    result_type max() const {
+      return probabilities_.empty()
+             ? static_cast<result_type>(0)
+             : static_cast<result_type>(probabilities_.size() - 1);
+    }
+
+    std::vector<double> probabilities() const {
+      return probabilities_;
+    }
+
+    // Number of random bits consumed by all samples so far.
+    uint64_t bits_consumed() const {
+      return bits_.consumed();
+    }
+
+    void reset() {
+      bits_.reset();
+    }
+
+  private:
+    // Walks down the levels below the stored tree, computing each level from
+    // the remainders of the expansions.  d is the position of the node among
+    // the internal nodes of the last stored level.
+    template<typename URNG>
+    result_type continue_walk(URNG& generator, size_t d) {
+      assert(!remainders_.empty());
+      std::vector<uint64_t> remainders(remainders_);
+      for (;;) {
+        d = 2 * d + (1 - bits_.next(generator));
+        size_t num_leaves = 0;
+        size_t outcome = 0;
+        for (size_t i = 0; i < remainders.size(); ++i) {
+          remainders[i] *= 2;
+          if (remainders[i] >= m_) {
+            if (num_leaves == d) outcome = i;
+            ++num_leaves;
+            remainders[i] -= m_;
+          }
+        }
+        if (d < num_leaves) return static_cast<result_type>(outcome);
+        d -= num_leaves;
+      }
+    }
+
+    void create_tree(const std::vector<uint64_t>& weights) {
+      const size_t n = weights.size();
+      uint64_t m = 0;
+      for (auto weight : weights) {
+        assert(weight < (static_cast<uint64_t>(1) << 63) - m);
+        m += weight;
+      }
+
+      m_ = m;
+      probabilities_.reserve(n);
+      for (auto weight : weights) {
+        probabilities_.push_back(static_cast<double>(weight) / m);
+      }
+
+      // If at most one weight is positive, no random bits are needed.  This
+      // also guarantees that every weight is less than 2^k below.
+      certain_outcome_ = 0;
+      size_t num_positive = 0;
+      for (size_t i = 0; i < n; ++i) {
+        if (weights[i] > 0) {
+          certain_outcome_ = i;
+          ++num_positive;
+        }
+      }
+      if (num_positive <= 1) return;
+
+      unsigned k = 0;
+      while ((static_cast<uint64_t>(1) << k) < m) ++k;
+
+      // Long division: the next bit of a_i / m is set if twice the
+      // remainder reaches m.  Every weight is less than m < 2^63 here, so
+      // doubling a remainder does not overflow.  At most m nodes of a level
+      // are internal, so a walk passes level k + 32 with probability less
+      // than 2^-32.
+      std::vector<uint64_t> remainders(weights);
+      offsets_.assign(1, 0);
+      bool finite = false;
+      for (unsigned level = 0; level < k + 32 && !finite; ++level) {
+        finite = true;
+        for (size_t i = 0; i < n; ++i) {
+          remainders[i] *= 2;
+          if (remainders[i] >= m) {
+            leaves_.push_back(i);
+            remainders[i] -= m;
+          }
+          finite &= remainders[i] == 0;
+        }
+        offsets_.push_back(leaves_.size());
+      }
+      if (!finite) remainders_.swap(remainders);
+    }
+
+    // Sum of the integer weights.
+    uint64_t m_;
+
+    // List of probabilities
+    std::vector<double> probabilities_;
+
+    // Leaves of level j are leaves_[offsets_[j]], ..., leaves_[offsets_[j+1]-1].
+    std::vector<size_t> leaves_;
+    std::vector<size_t> offsets_;
+
+    // Remainders of the expansions below the last stored level, or empty if
+    // the expansions end there.
+    std::vector<uint64_t> remainders_;
+
+    // The outcome returned when the tree is empty.
+    size_t certain_outcome_;
+
+    random_bit_buffer bits_;
+};
+
+#endif  // KNUTH_YAO_DISCRETE_DISTRIBUTION_HPP_
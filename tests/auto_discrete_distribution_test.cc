@@ -0,0 +1,90 @@
+// Tests for auto_discrete_distribution.
+//
+// Usage: auto_discrete_distribution_test [num_samples]
+
+#include "auto_discrete_distribution.hpp"
+
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// Checks every engine on the same weights.
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  const discrete_engine engines[] = {
+    discrete_engine::linear_scan, discrete_engine::binary_search,
+    discrete_engine::alias_table
+  };
+  bool ok = true;
+  for (const discrete_engine engine : engines) {
+    auto_discrete_distribution<int> distribution(weights, engine);
+    ok &= CheckGoodnessOfFit(discrete_engine_name(engine), distribution,
+                             weights, num_samples);
+  }
+  return ok;
+}
+
+// Weights 1, 2, ..., N, or N equal weights.
+bool TestChoice(const size_t N, const bool equal,
+                const discrete_engine expected) {
+  std::vector<double> weights(N);
+  for (size_t i = 0; i < N; ++i) weights[i] = equal ? 1.0 : i + 1.0;
+  auto_discrete_distribution<int> distribution(weights);
+  const bool ok = distribution.engine() == expected;
+  cout << "TestChoice N=" << N << (equal ? " equal" : "") << ": "
+       << (ok ? "OK" : "FAIL") << " ("
+       << discrete_engine_name(distribution.engine()) << ")" << endl;
+  return ok;
+}
+
+// Copies keep the engine and sample the same way.
+bool TestCopy(const discrete_engine engine) {
+  const auto_discrete_distribution<int> distribution({1, 2, 3}, engine);
+  auto_discrete_distribution<int> copy(distribution);
+  auto_discrete_distribution<int> assigned({1}, engine);
+  assigned = copy;
+  auto_discrete_distribution<int> original(distribution);
+  std::default_random_engine generator(3);
+  std::default_random_engine copy_generator(3);
+  std::default_random_engine assigned_generator(3);
+  bool ok = copy.engine() == engine && assigned.engine() == engine;
+  for (size_t i = 0; i < 1000; ++i) {
+    const int sample = original(generator);
+    ok &= copy(copy_generator) == sample;
+    ok &= assigned(assigned_generator) == sample;
+  }
+  cout << "TestCopy " << discrete_engine_name(engine) << ": "
+       << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(2000000);
+
+  bool ok = true;
+  ok &= Test({0}, 100);
+  ok &= Test({1}, 100);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({2, 1, 0}, num_samples);
+  ok &= Test({0, 1e-20, 0}, num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             num_samples);
+  ok &= TestChoice(0, false, discrete_engine::linear_scan);
+  ok &= TestChoice(1, true, discrete_engine::linear_scan);
+  ok &= TestChoice(4, false, discrete_engine::linear_scan);
+  ok &= TestChoice(16, false, discrete_engine::linear_scan);
+  ok &= TestChoice(17, false, discrete_engine::alias_table);
+  ok &= TestChoice(100000, false, discrete_engine::alias_table);
+  ok &= TestChoice(4, true, discrete_engine::alias_table);
+  ok &= TestChoice(16, true, discrete_engine::alias_table);
+  ok &= TestCopy(discrete_engine::linear_scan);
+  ok &= TestCopy(discrete_engine::alias_table);
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
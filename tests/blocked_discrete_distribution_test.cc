@@ -0,0 +1,69 @@
+// Tests for blocked_discrete_distribution.
+//
+// Usage: blocked_discrete_distribution_test [num_samples]
+
+#include "blocked_discrete_distribution.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+bool Test(const std::vector<double>& weights, const size_t block_size,
+          const size_t num_samples) {
+  blocked_discrete_distribution<int> distribution(weights, block_size);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+// Checks the table and its copy, which has storage of its own, and
+// that generate() returns the same samples as operator().
+bool TestTable(const std::vector<double>& weights) {
+  typedef blocked_discrete_distribution<int> Distribution;
+  const Distribution distribution(weights);
+  bool ok = distribution.verify() <= 1e-12;
+
+  const Distribution copy(distribution);
+  ok &= copy.verify() == distribution.verify();
+
+  cout << "TestTable N=" << weights.size() << " blocks="
+       << distribution.num_blocks() << ": " << (ok ? "OK" : "FAIL") << endl;
+  ok &= CheckGenerateMatchesSampling(
+    "TestGenerate N=" + std::to_string(weights.size()), copy);
+  return ok;
+}
+
+// A block that has only zero weights is never chosen.
+bool TestZeroBlock(const size_t num_samples) {
+  std::vector<double> weights(12, 1.0);
+  for (size_t i = 4; i < 8; ++i) weights[i] = 0.0;
+  return Test(weights, 4, num_samples);
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= Test({0}, 4, 100);
+  ok &= Test({1}, 4, 100);
+  ok &= Test({1, 0, 2}, 1, num_samples);
+  ok &= Test({1, 0, 2}, 2, num_samples);
+  ok &= Test({0, 1e-20, 0}, 2, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             4, num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, 3, num_samples);
+  ok &= Test(RandomWeights(1000),
+             blocked_discrete_distribution<int>::kDefaultBlockSize,
+             num_samples);
+  ok &= TestZeroBlock(num_samples);
+  ok &= TestTable(RandomWeights(1000));
+  ok &= TestTable(RandomWeights(1000000));
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
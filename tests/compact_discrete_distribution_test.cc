@@ -0,0 +1,79 @@
+// Tests for compact_discrete_distribution.
+//
+// Usage: compact_discrete_distribution_test [num_samples]
+
+#include "compact_discrete_distribution.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// Checks the samples against the probabilities realized by the table, and
+// the distance of those from the weights against the documented bound.  All
+// zero weights have no probabilities to compare.
+template<typename IndexType>
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  typedef compact_discrete_distribution<int, IndexType> Distribution;
+  Distribution distribution(weights);
+  const std::vector<double> probabilities = distribution.probabilities();
+  const std::vector<double> table = distribution.table_probabilities();
+
+  double distance = 0.0;
+  for (size_t i = 0; i < table.size(); ++i)
+    distance += std::fabs(table[i] - probabilities[i]);
+  bool ok =
+    !(distance / 2 > std::ldexp(1.0, -Distribution::kBits - 1) * 1.001);
+  if (!ok)
+    cout << "Test N=" << weights.size() << ": FAIL (total variation "
+         << distance / 2 << ")" << endl;
+  ok &= CheckGoodnessOfFit("Test", distribution, table, num_samples);
+  return ok;
+}
+
+bool TestEmpty() {
+  std::default_random_engine generator;
+  compact_discrete_distribution<int> distribution({});
+  const bool ok = distribution(generator) == 0 && distribution.max() == 0;
+  cout << "TestEmpty: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// Largest supports, where every index bit is used.
+template<typename IndexType>
+bool TestFull(const size_t num_samples) {
+  const size_t N = compact_discrete_distribution<int, IndexType>::kMaxSupport;
+  std::default_random_engine generator(N);
+  std::exponential_distribution<double> exponential(1.0);
+  std::vector<double> weights(N);
+  for (auto& weight : weights) weight = exponential(generator);
+  return Test<IndexType>(weights, num_samples);
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= TestEmpty();
+  ok &= Test<uint16_t>({0}, 100);
+  ok &= Test<uint16_t>({1}, 100);
+  ok &= Test<uint16_t>({1, 0, 2}, num_samples);
+  ok &= Test<uint16_t>({0, 1e-20, 0}, num_samples);
+  ok &= Test<uint16_t>({1 - 1e-10, 1 - 1e-10, 1 - 1e-10}, num_samples);
+  ok &= Test<uint16_t>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+                       num_samples);
+  ok &= Test<uint16_t>({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= Test<uint8_t>({1, 0, 2}, num_samples);
+  ok &= Test<uint8_t>({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= TestFull<uint8_t>(num_samples);
+  ok &= TestFull<uint16_t>(num_samples);
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
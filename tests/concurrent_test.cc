@@ -0,0 +1,108 @@
+// Tests for concurrent_discrete_distribution.
+//
+// Usage: concurrent_test [num_samples]
+
+#include "concurrent_discrete_distribution.hpp"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// Copyable reference to a shared distribution, usable with
+// CheckGoodnessOfFit.  All sampling threads use the same object.
+class SharedDistribution {
+  public:
+    typedef int result_type;
+
+    explicit SharedDistribution(
+      const concurrent_discrete_distribution<int>& distribution)
+      : distribution_(distribution) { }
+
+    int operator()(std::default_random_engine& generator) const {
+      return distribution_(generator);
+    }
+
+  private:
+    const concurrent_discrete_distribution<int>& distribution_;
+};
+
+// Samples follow the weights of the latest update.
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  concurrent_discrete_distribution<int> distribution({1, 1, 1});
+  distribution.update(weights);
+  return CheckGoodnessOfFit("Test", SharedDistribution(distribution), weights,
+                            num_samples);
+}
+
+// Readers sample while a writer publishes num_versions tables.  Table v puts
+// all mass on outcome v, so every reader must see non-decreasing outcomes, and
+// a reader using a freed table would see garbage.
+bool TestHotSwap(const size_t num_versions) {
+  std::vector<double> weights(num_versions, 0.0);
+  weights[0] = 1.0;
+  concurrent_discrete_distribution<int> distribution(weights);
+
+  std::atomic<bool> done(false);
+  std::atomic<bool> ok(true);
+  std::vector<std::thread> readers;
+  for (unsigned t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t]() {
+      std::default_random_engine generator(t + 1);
+      int last = 0;
+      while (!done.load()) {
+        const int outcome = distribution(generator);
+        if (outcome < last || outcome >= static_cast<int>(num_versions))
+          ok.store(false);
+        last = outcome;
+      }
+    });
+  }
+
+  for (size_t v = 1; v < num_versions; ++v) {
+    weights[v - 1] = 0.0;
+    weights[v] = 1.0;
+    distribution.update(weights);
+    if (v % 16 == 0) std::this_thread::yield();
+  }
+  done.store(true);
+  for (auto& reader : readers) reader.join();
+
+  std::default_random_engine generator;
+  if (distribution(generator) != static_cast<int>(num_versions - 1))
+    ok.store(false);
+  cout << "TestHotSwap versions=" << num_versions << ": "
+       << (ok.load() ? "OK" : "FAIL") << endl;
+  return ok.load();
+}
+
+// min() and max() follow the current table, including sparse ones.
+bool TestRange() {
+  concurrent_discrete_distribution<int> distribution({1, 1, 1});
+  bool ok = distribution.min() == 0 && distribution.max() == 2;
+  distribution.update(std::vector<std::pair<int, double>>{{5, 1}, {17, 2}});
+  ok &= distribution.min() == 5 && distribution.max() == 17;
+  cout << "TestRange: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(2000000);
+
+  bool ok = true;
+  ok &= Test({1}, 100);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= TestHotSwap(256);
+  ok &= TestRange();
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
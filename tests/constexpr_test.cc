@@ -0,0 +1,54 @@
+// Tests for compile-time construction of fast_discrete_distribution<IntType, N>.
+// Requires C++17.
+//
+// Usage: constexpr_test [num_samples]
+
+#include "fast_discrete_distribution.hpp"
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// The table is built by the compiler.
+static constexpr fast_discrete_distribution<int, 4> kDistribution(
+  {1, 2, 3, 4});
+static_assert(kDistribution.max() == 3, "Wrong support.");
+static_assert(kDistribution.probabilities()[0] == 0.1, "Wrong probability.");
+static_assert(kDistribution.probabilities()[3] == 0.4, "Wrong probability.");
+
+static constexpr fast_discrete_distribution<int, 3> kDistributionWithZero(
+  {1, 0, 2});
+static_assert(kDistributionWithZero.probabilities()[1] == 0.0,
+              "Wrong probability.");
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= CheckGoodnessOfFit("TestConstexpr", kDistribution, {1, 2, 3, 4},
+                           num_samples);
+  ok &= CheckGoodnessOfFit("TestConstexpr", kDistributionWithZero, {1, 0, 2},
+                           num_samples);
+
+  // The compile-time table is the same as the run-time table.
+  const std::array<double, 4> weights = {{1, 2, 3, 4}};
+  const fast_discrete_distribution<int, 4> runtime_distribution(weights);
+  std::default_random_engine constexpr_generator(9);
+  std::default_random_engine runtime_generator(9);
+  bool same = true;
+  for (size_t i = 0; i < 100000; ++i) {
+    same &= kDistribution(constexpr_generator)
+            == runtime_distribution(runtime_generator);
+  }
+  cout << "TestSameAsRuntime: " << (same ? "OK" : "FAIL") << endl;
+  ok &= same;
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Tests for distribution_pool.
+//
+// Usage: distribution_pool_test [num_samples]
+
+#include "distribution_pool.hpp"
+
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// One distribution of a pool, usable with CheckGoodnessOfFit.
+class PoolMember {
+  public:
+    typedef int result_type;
+
+    PoolMember(const distribution_pool<int>& pool, const size_t v)
+      : pool_(pool), v_(v) { }
+
+    int operator()(std::default_random_engine& generator) const {
+      return pool_.sample(v_, generator);
+    }
+
+  private:
+    const distribution_pool<int>& pool_;
+    size_t v_;
+};
+
+// Builds a pool from a list of weight vectors and checks each distribution.
+bool Test(const std::vector<std::vector<double>>& rows,
+          const size_t num_threads, const size_t num_samples) {
+  std::vector<size_t> offsets(1, 0);
+  std::vector<double> weights;
+  for (const auto& row : rows) {
+    weights.insert(weights.end(), row.begin(), row.end());
+    offsets.push_back(weights.size());
+  }
+  distribution_pool<int> pool(offsets, weights, num_threads);
+
+  bool ok = pool.size() == rows.size();
+  for (size_t v = 0; v < rows.size(); ++v) {
+    ok &= pool.support_size(v) == rows[v].size();
+    ok &= CheckGoodnessOfFit("Test", PoolMember(pool, v), rows[v],
+                             num_samples);
+  }
+  return ok;
+}
+
+// A pool built in parallel produces the same samples as one built serially.
+bool TestParallelBuild() {
+  std::default_random_engine generator(13);
+  std::exponential_distribution<double> exponential(1.0);
+  std::uniform_int_distribution<size_t> degree(0, 20);
+  std::vector<size_t> offsets(1, 0);
+  std::vector<double> weights;
+  for (size_t v = 0; v < 100000; ++v) {
+    const size_t n = degree(generator);
+    for (size_t k = 0; k < n; ++k) weights.push_back(exponential(generator));
+    offsets.push_back(weights.size());
+  }
+
+  distribution_pool<int> serial(offsets, weights, 1);
+  distribution_pool<int> parallel(offsets, weights, 4);
+  std::default_random_engine serial_generator(1);
+  std::default_random_engine parallel_generator(1);
+  bool ok = true;
+  for (size_t i = 0; i < 1000000; ++i) {
+    const size_t v = i % serial.size();
+    ok &= serial.sample(v, serial_generator)
+          == parallel.sample(v, parallel_generator);
+  }
+  cout << "TestParallelBuild: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// sample_many() produces the same samples as sample() in a loop, including
+// for distributions without outcomes and across block boundaries.
+bool TestSampleMany() {
+  std::default_random_engine generator(29);
+  std::exponential_distribution<double> exponential(1.0);
+  std::uniform_int_distribution<size_t> degree(0, 20);
+  std::vector<size_t> offsets(1, 0);
+  std::vector<double> weights;
+  for (size_t v = 0; v < 10000; ++v) {
+    const size_t n = degree(generator);
+    for (size_t k = 0; k < n; ++k) weights.push_back(exponential(generator));
+    offsets.push_back(weights.size());
+  }
+  distribution_pool<int> pool(offsets, weights);
+
+  std::uniform_int_distribution<size_t> node(0, pool.size() - 1);
+  std::vector<size_t> ids(100003);
+  for (auto& id : ids) id = node(generator);
+
+  std::default_random_engine single_generator(1);
+  std::default_random_engine many_generator(1);
+  std::vector<int> samples(ids.size());
+  pool.sample_many(ids.data(), ids.data() + ids.size(), many_generator,
+                   samples.data());
+  bool ok = true;
+  for (size_t i = 0; i < ids.size(); ++i)
+    ok &= samples[i] == pool.sample(ids[i], single_generator);
+  cout << "TestSampleMany: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(2000000);
+
+  const std::vector<std::vector<double>> rows = {
+    {1},
+    {},
+    {1, 1},
+    {1, 0, 2},
+    {20, 10, 30},
+    {0, 1e-20, 0},
+    {1e-3, 1, 1e3, 1e6},
+    {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+  };
+
+  bool ok = true;
+  ok &= Test(rows, 1, num_samples);
+  ok &= Test(rows, 3, num_samples);
+  ok &= TestParallelBuild();
+  ok &= TestSampleMany();
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Tests for dynamic_discrete_distribution.
+//
+// Usage: dynamic_discrete_distribution_test [num_samples]
+
+#include "dynamic_discrete_distribution.hpp"
+
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  dynamic_discrete_distribution<int> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+// Applies random updates, each changing a few weights, and checks the samples
+// after every round against the current weights.
+bool TestUpdates(const size_t N, const size_t num_rounds,
+                 const size_t num_samples) {
+  std::default_random_engine generator(N);
+  std::exponential_distribution<double> exponential(1.0);
+  std::uniform_int_distribution<size_t> outcome(0, N - 1);
+  std::vector<double> weights(N);
+  for (auto& weight : weights) weight = exponential(generator);
+  dynamic_discrete_distribution<int> distribution(weights);
+
+  bool ok = true;
+  for (size_t round = 0; round < num_rounds; ++round) {
+    for (size_t j = 0; j < 1 + N / 100; ++j) {
+      const size_t i = outcome(generator);
+      // Mix zeros, small changes and weights far above the average.
+      const double u = exponential(generator);
+      weights[i] = u < 0.3 ? 0.0 : u > 3.0 ? u * N / 4 : u;
+      distribution.set_weight(i, weights[i]);
+    }
+    ok &= distribution.acceptance() >= 0.5;
+    ok &= CheckGoodnessOfFit("TestUpdates", distribution, weights,
+                             num_samples);
+  }
+  return ok;
+}
+
+// All weights drop to zero and come back.
+bool TestZero(const size_t num_samples) {
+  std::vector<double> weights = {1, 2, 3};
+  dynamic_discrete_distribution<int> distribution(weights);
+  for (size_t i = 0; i < weights.size(); ++i) distribution.set_weight(i, 0.0);
+  std::default_random_engine generator;
+  bool ok = distribution(generator) == 0;
+  distribution.set_weight(1, 5.0);
+  ok &= CheckGoodnessOfFit("TestZero", distribution, {0, 5, 0}, num_samples);
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(1000000);
+
+  bool ok = true;
+  ok &= Test({0}, 100);
+  ok &= Test({1}, 100);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({0, 1e-20, 0}, num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             num_samples);
+  ok &= TestUpdates(10, 20, num_samples);
+  ok &= TestUpdates(1000, 5, num_samples);
+  ok &= TestZero(num_samples);
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
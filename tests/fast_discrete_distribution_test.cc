@@ -0,0 +1,277 @@
+// Tests for fast_discrete_distribution.
+//
+// Usage: fast_discrete_distribution_test [num_samples]
+
+#include "fast_discrete_distribution.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  fast_discrete_distribution<int> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+// Integer weights build the table in exact arithmetic.
+bool TestInteger(const std::vector<uint64_t>& weights,
+                 const size_t num_samples) {
+  fast_discrete_distribution<int> distribution(weights);
+  const std::vector<double> real_weights(weights.begin(), weights.end());
+  const double deviation = distribution.verify();
+  if (deviation > 1e-15) {
+    cout << "TestInteger N=" << weights.size() << ": FAIL (max deviation "
+         << deviation << ")" << endl;
+    return false;
+  }
+  return CheckGoodnessOfFit("TestInteger", distribution, real_weights,
+                            num_samples);
+}
+
+// Checks that the bucket table reproduces the probabilities up to rounding.
+bool TestVerify(const std::vector<double>& weights) {
+  fast_discrete_distribution<int> distribution(weights);
+  const double deviation = distribution.verify();
+  const double parallel_deviation = distribution.verify(4);
+  const bool ok = deviation <= 1e-12 && parallel_deviation == deviation;
+  cout << "TestVerify N=" << weights.size() << ": "
+       << (ok ? "OK" : "FAIL") << " (max deviation " << deviation << ")"
+       << endl;
+  return ok;
+}
+
+bool TestEmpty(const size_t num_samples) {
+  std::default_random_engine generator;
+  fast_discrete_distribution<int> distribution({});
+
+  for (size_t i = 0; i < num_samples; ++i) {
+    const int number = distribution(generator);
+    if (number != 0) {
+      cout << "TestEmpty: FAIL" << endl;
+      return false;
+    }
+  }
+  cout << "TestEmpty: OK" << endl;
+  return true;
+}
+
+// Returns true if both distributions have the same probabilities and produce
+// the same samples from the same generator.
+bool SameDistribution(fast_discrete_distribution<int> a,
+                      fast_discrete_distribution<int> b) {
+  if (a.probabilities() != b.probabilities()) return false;
+  std::default_random_engine a_generator(3);
+  std::default_random_engine b_generator(3);
+  for (size_t i = 0; i < 10000; ++i) {
+    if (a(a_generator) != b(b_generator)) return false;
+  }
+  return true;
+}
+
+// The range, initializer list, move and function constructors build the same
+// table as the vector constructor.
+bool TestConstructors() {
+  const std::vector<double> weights = {1e-3, 1, 0, 1e3, 1e6, 2.5};
+  const fast_discrete_distribution<int> expected(weights);
+
+  bool ok = true;
+  const std::list<double> list(weights.begin(), weights.end());
+  ok &= SameDistribution(expected, fast_discrete_distribution<int>(
+                                     list.begin(), list.end()));
+
+  // Input iterators can be read only once.
+  std::istringstream stream("1e-3 1 0 1e3 1e6 2.5");
+  ok &= SameDistribution(expected, fast_discrete_distribution<int>(
+                                     std::istream_iterator<double>(stream),
+                                     std::istream_iterator<double>()));
+
+  ok &= SameDistribution(expected, {1e-3, 1, 0, 1e3, 1e6, 2.5});
+
+  std::vector<double> moved(weights);
+  ok &= SameDistribution(expected,
+                         fast_discrete_distribution<int>(std::move(moved)));
+
+  // Outcome k has weight fw(0.5 + k) = (0.5 + k)^2.
+  std::vector<double> squares;
+  for (size_t k = 0; k < 100; ++k) squares.push_back((0.5 + k) * (0.5 + k));
+  ok &= SameDistribution(
+    fast_discrete_distribution<int>(squares),
+    fast_discrete_distribution<int>(100, 0.0, 100.0,
+                                    [](double x) { return x * x; }));
+  ok &= fast_discrete_distribution<int>(0, 0.0, 1.0, [](double) {
+    return 2.0;
+  }).probabilities() == std::vector<double>(1, 1.0);
+
+  // Two numbers are not a range of weights.
+  ok &= !std::is_constructible<fast_discrete_distribution<int>,
+                               double, double>::value;
+
+  cout << "TestConstructors: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// Tables built once as a param_type can be copied and swapped into
+// distributions, and rebuilt in place.
+bool TestParam() {
+  typedef fast_discrete_distribution<int>::param_type param_type;
+  const std::vector<double> weights = {1e-3, 1, 0, 1e3, 1e6, 2.5};
+  const std::vector<double> other_weights = {3, 1, 4, 1, 5};
+  const fast_discrete_distribution<int> expected(weights);
+  const param_type param(weights);
+
+  bool ok = param == expected.param();
+  ok &= param != param_type(other_weights);
+  ok &= SameDistribution(expected, fast_discrete_distribution<int>(param));
+
+  fast_discrete_distribution<int> distribution(other_weights);
+  distribution.param(param);
+  ok &= distribution.param() == param;
+  ok &= SameDistribution(expected, distribution);
+
+  // Double buffering: the spare table receives the previous table and is
+  // rebuilt in its storage for the next update.
+  param_type spare;
+  spare.assign(other_weights.begin(), other_weights.end());
+  distribution.param(std::move(spare));
+  ok &= SameDistribution(fast_discrete_distribution<int>(other_weights),
+                         distribution);
+  ok &= spare == param;
+  spare.assign(weights.begin(), weights.end());
+  distribution.param(std::move(spare));
+  ok &= SameDistribution(expected, distribution);
+
+  cout << "TestParam: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// 64-bit outcomes use wide tables, which draw the bucket index as an exact
+// integer.  generate() must agree with operator().
+bool TestWide(const std::vector<double>& weights, const size_t num_samples) {
+  fast_discrete_distribution<int64_t> distribution(weights);
+  bool ok = distribution.verify() <= 1e-12;
+
+  if (!ok) cout << "TestWide N=" << weights.size() << ": FAIL" << endl;
+  ok &= CheckGenerateMatchesSampling(
+    "TestWide generate() N=" + std::to_string(weights.size()), distribution);
+
+  ok &= CheckGoodnessOfFit("TestWide", distribution, weights, num_samples);
+  return ok;
+}
+
+// Maps the samples of a sparse distribution to positions in its outcomes(),
+// for CheckGoodnessOfFit.
+class SparsePositions {
+  public:
+    typedef int result_type;
+
+    explicit SparsePositions(const fast_discrete_distribution<int>& distribution)
+      : distribution_(distribution) { }
+
+    int operator()(std::default_random_engine& generator) {
+      const int outcome = distribution_(generator);
+      const std::vector<int>& outcomes = distribution_.outcomes();
+      const auto it = std::lower_bound(outcomes.begin(), outcomes.end(),
+                                       outcome);
+      if (it == outcomes.end() || *it != outcome) return -1;
+      return static_cast<int>(it - outcomes.begin());
+    }
+
+  private:
+    fast_discrete_distribution<int> distribution_;
+};
+
+// Sparse weights over a huge id space.  Zero weights are dropped and repeated
+// outcomes are merged.
+bool TestSparse(const size_t num_samples) {
+  const fast_discrete_distribution<int> distribution(
+    std::vector<std::pair<int, double>>{
+      {1000000000, 3}, {5, 1}, {17, 0.5}, {5, 1}, {42, 0}, {123456789, 1e-3}});
+  bool ok = distribution.outcomes()
+            == std::vector<int>({5, 17, 123456789, 1000000000});
+  ok &= distribution.min() == 5;
+  ok &= distribution.max() == 1000000000;
+  ok &= distribution.verify() < 1e-15;
+  if (!ok) cout << "TestSparse: FAIL" << endl;
+  ok &= CheckGoodnessOfFit("TestSparse", SparsePositions(distribution),
+                           {2, 0.5, 1e-3, 3}, num_samples);
+
+  // No positive weight.
+  std::default_random_engine generator;
+  const std::vector<std::pair<int, double>> zeros = {{7, 0}};
+  fast_discrete_distribution<int> empty(zeros);
+  ok &= empty.outcomes().empty() && empty(generator) == 0;
+  return ok;
+}
+
+// The optional argument sets the number of samples used by the large tests.
+// Pass a large value (e.g. 10000000000) for a thorough run on a many-core
+// machine.
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= TestEmpty(100);
+  ok &= Test({0}, 100);
+  ok &= Test({1}, 100);
+  ok &= Test({1, 1}, num_samples);
+  ok &= Test({1, 1, 1}, num_samples);
+  ok &= Test({1, 1, 2}, num_samples);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({20, 10, 30}, num_samples);
+  ok &= Test({0, 1e-20, 0}, num_samples);
+  ok &= Test({1 - 1e-10, 1 - 1e-10, 1 - 1e-10}, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+
+  ok &= TestInteger({}, 100);
+  ok &= TestInteger({5}, 100);
+  ok &= TestInteger({1, 0, 2}, num_samples);
+  ok &= TestInteger({20, 10, 30}, num_samples);
+  ok &= TestInteger({1, 1000, 1000000, 3}, num_samples);
+  ok &= TestInteger({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+                    num_samples);
+
+  ok &= TestConstructors();
+  ok &= TestParam();
+  ok &= TestSparse(num_samples);
+  ok &= TestWide({1}, 100);
+  ok &= TestWide({1, 0, 2}, num_samples);
+  ok &= TestWide({1e-3, 1, 1e3, 1e6}, num_samples);
+  {
+    std::vector<double> weights(100000);
+    std::default_random_engine generator;
+    std::exponential_distribution<double> exponential(1.0);
+    for (auto& weight : weights) weight = exponential(generator);
+    ok &= TestWide(weights, num_samples);
+  }
+
+  ok &= TestVerify({1});
+  ok &= TestVerify({1, 0, 2});
+  ok &= TestVerify({20, 10, 30});
+  ok &= TestVerify({1 - 1e-10, 1 - 1e-10, 1 - 1e-10});
+  ok &= TestVerify({1e-3, 1, 1e3, 1e6});
+  {
+    std::vector<double> weights(100000);
+    std::default_random_engine generator;
+    std::exponential_distribution<double> exponential(1.0);
+    for (auto& weight : weights) weight = exponential(generator);
+    ok &= TestVerify(weights);
+  }
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+// Tests for fast_discrete_distribution with a fixed support size.
+//
+// Usage: fixed_support_test [num_samples]
+
+#include "fast_discrete_distribution.hpp"
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+template<size_t N>
+bool Test(const std::array<double, N>& weights, const size_t num_samples) {
+  fast_discrete_distribution<int, N> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution,
+                            std::vector<double>(weights.begin(), weights.end()),
+                            num_samples);
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= Test<1>({{0}}, 100);
+  ok &= Test<1>({{1}}, 100);
+  ok &= Test<2>({{1, 1}}, num_samples);
+  ok &= Test<3>({{1, 0, 2}}, num_samples);
+  ok &= Test<3>({{0, 1e-20, 0}}, num_samples);
+  ok &= Test<3>({{1 - 1e-10, 1 - 1e-10, 1 - 1e-10}}, num_samples);
+  ok &= Test<4>({{1e-3, 1, 1e3, 1e6}}, num_samples);
+  ok &= Test<4>({{0.1, 0.2, 0.3, 0.4}}, num_samples);
+  ok &= Test<8>({{8, 7, 6, 5, 4, 3, 2, 1}}, num_samples);
+  ok &= Test<25>({{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25}},
+                 num_samples);
+
+  // No heap storage and no other state: a 4-outcome distribution is exactly
+  // 4 thresholds, 4 aliases and 4 probabilities.  The 4 aliases fill 16
+  // bytes, so there is no padding.
+  static_assert(sizeof(fast_discrete_distribution<int, 4>)
+                == 4 * (2 * sizeof(double) + sizeof(int)),
+                "Table must be stored inline.");
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
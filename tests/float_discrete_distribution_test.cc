@@ -0,0 +1,91 @@
+// Tests for float_discrete_distribution.
+//
+// Usage: float_discrete_distribution_test [num_samples]
+
+#include "float_discrete_distribution.hpp"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+template<typename RealType>
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  float_discrete_distribution<int, RealType> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+// Checks the deviation of the table and of the stored probabilities against
+// the bounds documented in float_discrete_distribution.hpp.
+bool TestAccuracy(const std::vector<double>& weights) {
+  const size_t N = weights.size();
+  float_discrete_distribution<int, float> distribution(weights);
+  const std::vector<float> probabilities = distribution.probabilities();
+  double sum = 0.0;
+  for (auto weight : weights) sum += weight;
+
+  bool ok = true;
+  double max_relative_error = 0.0;
+  double max_probability = 0.0;
+  for (size_t i = 0; i < N; ++i) {
+    const double p = weights[i] / sum;
+    max_probability = std::max(max_probability, p);
+    if (p > 0.0) {
+      max_relative_error =
+        std::max(max_relative_error, std::fabs(probabilities[i] - p) / p);
+    }
+  }
+  ok &= max_relative_error <= std::ldexp(1.0, -22);
+
+  // Every outcome occupies at most 1 + N max_probability buckets.
+  const double deviation = distribution.verify();
+  ok &= deviation <= std::ldexp(max_probability, -22)
+                     + (1.0 + N * max_probability) * std::ldexp(1.0, -25) / N;
+
+  float_discrete_distribution<int, double> double_distribution(weights);
+  ok &= double_distribution.verify() <= 1e-12;
+
+  cout << "TestAccuracy N=" << N << ": relative error " << max_relative_error
+       << ", deviation " << deviation << ": " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// Checks that generate() returns the same samples as operator().
+template<typename RealType>
+bool TestGenerate(const std::vector<double>& weights) {
+  return CheckGenerateMatchesSampling(
+    "TestGenerate N=" + std::to_string(weights.size()),
+    float_discrete_distribution<int, RealType>(weights));
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= Test<float>({0}, 100);
+  ok &= Test<float>({1}, 100);
+  ok &= Test<float>({1, 0, 2}, num_samples);
+  ok &= Test<float>({0, 1e-20, 0}, num_samples);
+  ok &= Test<float>({1 - 1e-10, 1 - 1e-10, 1 - 1e-10}, num_samples);
+  ok &= Test<float>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+                    num_samples);
+  ok &= Test<float>({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= Test<float>(RandomWeights(1000), num_samples);
+  ok &= Test<double>({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= TestAccuracy(RandomWeights(1000));
+  ok &= TestAccuracy(RandomWeights(1000000));
+  ok &= TestAccuracy({1e-3, 1, 1e3, 1e6});
+  ok &= TestGenerate<float>(RandomWeights(1000));
+  // Large enough for generate() to prefetch.
+  ok &= TestGenerate<float>(RandomWeights(1000000));
+  ok &= TestGenerate<double>(RandomWeights(1000));
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
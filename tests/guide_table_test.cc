@@ -0,0 +1,55 @@
+// Tests for guide_table_discrete_distribution.
+//
+// Usage: guide_table_test [num_samples]
+
+#include "guide_table_discrete_distribution.hpp"
+
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  guide_table_discrete_distribution<int> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+bool TestEmpty(const size_t num_samples) {
+  std::default_random_engine generator;
+  guide_table_discrete_distribution<int> distribution({});
+
+  for (size_t i = 0; i < num_samples; ++i) {
+    if (distribution(generator) != 0) {
+      cout << "TestEmpty: FAIL" << endl;
+      return false;
+    }
+  }
+  cout << "TestEmpty: OK" << endl;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= TestEmpty(100);
+  ok &= Test({0}, 100);
+  ok &= Test({1}, 100);
+  ok &= Test({1, 1}, num_samples);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({2, 1, 0}, num_samples);
+  ok &= Test({0, 1e-20, 0}, num_samples);
+  ok &= Test({20, 10, 30}, num_samples);
+  ok &= Test({1 - 1e-10, 1 - 1e-10, 1 - 1e-10}, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= Test({1e6, 1e3, 1, 1e-3}, num_samples);
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// Tests for the runtime-dispatched kernels.
+//
+// Usage: kernels_test [num_samples]
+//
+// Every variant supported by the CPU is forced in turn.  Bulk sampling must
+// reproduce operator() exactly and pass the statistical checks, and
+// normalization must agree with the portable kernel bit for bit.
+
+#include "fast_discrete_distribution.hpp"
+#include "float_discrete_distribution.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// Distribution adaptor that draws samples through generate() in blocks, so
+// that CheckGoodnessOfFit exercises the bulk path.
+class BulkSampler {
+  public:
+    typedef int result_type;
+
+    BulkSampler(const std::vector<double>& weights)
+      : distribution_(weights), buffer_(1000), position_(buffer_.size()) { }
+
+    int operator()(std::default_random_engine& generator) {
+      if (position_ == buffer_.size()) {
+        distribution_.generate(generator, buffer_.data(),
+                               buffer_.data() + buffer_.size());
+        position_ = 0;
+      }
+      return buffer_[position_++];
+    }
+
+  private:
+    fast_discrete_distribution<int> distribution_;
+    std::vector<int> buffer_;
+    size_t position_;
+};
+
+// Checks that generate() returns the same samples as operator() at every
+// prefetch distance and for the single-precision table.
+bool TestMatchesScalar(const std::vector<double>& weights) {
+  const std::string suffix = " N=" + std::to_string(weights.size());
+  bool ok = true;
+  const size_t distances[] = {
+    0, 1, 32, fast_discrete_distribution<int>::kMaxPrefetchDistance
+  };
+  for (const size_t distance : distances) {
+    fast_discrete_distribution<int> distribution(weights);
+    distribution.set_prefetch_distance(distance);
+    ok &= CheckGenerateMatchesSampling(
+      "TestMatchesScalar" + suffix + " distance=" + std::to_string(distance),
+      distribution);
+  }
+  ok &= CheckGenerateMatchesSampling("TestFloatMatchesScalar" + suffix,
+                                     float_discrete_distribution<int>(weights));
+  return ok;
+}
+
+// Checks that normalization agrees with the portable kernel.
+bool TestNormalization(const std::vector<double>& weights,
+                       const std::vector<double>& expected) {
+  fast_discrete_distribution<int> distribution(weights);
+  const bool ok = distribution.probabilities() == expected;
+  cout << "TestNormalization N=" << weights.size() << ": "
+       << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(2000000);
+  const size_t sizes[] = {0, 1, 3, 7, 1000, 100003};
+
+  force_kernel_isa(kernel_isa::generic);
+  std::vector<std::vector<double>> expected_probabilities;
+  for (const size_t N : sizes) {
+    expected_probabilities.push_back(
+      fast_discrete_distribution<int>(RandomWeights(N)).probabilities());
+  }
+
+  bool ok = true;
+  const kernel_isa variants[] = {
+    kernel_isa::generic, kernel_isa::sse2, kernel_isa::avx2, kernel_isa::avx512
+  };
+  for (const kernel_isa isa : variants) {
+    if (!force_kernel_isa(isa)) {
+      cout << "Variant " << kernel_isa_name(isa) << ": not supported" << endl;
+      continue;
+    }
+    cout << "Variant " << kernel_isa_name(isa) << endl;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+      const std::vector<double> weights = RandomWeights(sizes[i]);
+      ok &= TestMatchesScalar(weights);
+      ok &= TestNormalization(weights, expected_probabilities[i]);
+    }
+    ok &= CheckGoodnessOfFit("TestBulk", BulkSampler({1, 2, 3, 4, 5}),
+                             {1, 2, 3, 4, 5}, num_samples);
+    ok &= CheckGoodnessOfFit("TestBulk", BulkSampler(RandomWeights(1000)),
+                             RandomWeights(1000), num_samples);
+  }
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// Tests for knuth_yao_discrete_distribution.
+//
+// Usage: knuth_yao_test [num_samples]
+
+#include "knuth_yao_discrete_distribution.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+bool Test(const std::vector<double>& weights, const size_t num_samples) {
+  knuth_yao_discrete_distribution<int> distribution(weights);
+  return CheckGoodnessOfFit("Test", distribution, weights, num_samples);
+}
+
+bool TestInteger(const std::vector<uint64_t>& weights,
+                 const size_t num_samples) {
+  knuth_yao_discrete_distribution<int> distribution(weights);
+  const std::vector<double> real_weights(weights.begin(), weights.end());
+  return CheckGoodnessOfFit("TestInteger", distribution, real_weights,
+                            num_samples);
+}
+
+// The expected number of bits per sample is at least H and less than H + 2.
+bool TestEntropy(const std::vector<double>& weights, const size_t num_samples) {
+  knuth_yao_discrete_distribution<int> distribution(weights);
+  std::default_random_engine generator(11);
+  for (size_t i = 0; i < num_samples; ++i) distribution(generator);
+
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  double entropy = 0.0;
+  for (auto weight : weights) {
+    if (weight > 0.0) entropy -= weight / sum * std::log2(weight / sum);
+  }
+  const double bits =
+    static_cast<double>(distribution.bits_consumed()) / num_samples;
+  const bool ok = bits > entropy - 0.01 && bits < entropy + 2.0;
+  cout << "TestEntropy N=" << weights.size() << ": " << (ok ? "OK" : "FAIL")
+       << " (entropy " << entropy << ", bits per sample " << bits << ")"
+       << endl;
+  return ok;
+}
+
+// A distribution with a single possible outcome consumes no bits.
+bool TestCertain() {
+  knuth_yao_discrete_distribution<int> distribution({0, 5, 0});
+  std::default_random_engine generator;
+  bool ok = true;
+  for (size_t i = 0; i < 100; ++i) ok &= distribution(generator) == 1;
+  ok &= distribution.bits_consumed() == 0;
+  cout << "TestCertain: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// Returns a word of zero bits, then words of one bits.
+class ZerosThenOnes {
+  public:
+    typedef uint64_t result_type;
+
+    ZerosThenOnes() : calls_(0) { }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~static_cast<uint64_t>(0); }
+
+    result_type operator()() { return calls_++ == 0 ? 0 : max(); }
+
+  private:
+    size_t calls_;
+};
+
+// For weights {1, 1, 1}, zero bits alternate between levels without leaves
+// and the right end of levels with three leaves, so the first 64 bits lead
+// below the stored tree.  The next two one bits then reach outcome 0.
+bool TestDeepWalk() {
+  knuth_yao_discrete_distribution<int> distribution(
+    std::vector<uint64_t>{1, 1, 1});
+  ZerosThenOnes generator;
+  const int outcome = distribution(generator);
+  const bool ok = outcome == 0 && distribution.bits_consumed() == 66;
+  cout << "TestDeepWalk: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t num_samples =
+    argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(10000000);
+
+  bool ok = true;
+  ok &= Test({0}, 100);
+  ok &= Test({1}, 100);
+  ok &= Test({1, 1}, num_samples);
+  ok &= Test({1, 0, 2}, num_samples);
+  ok &= Test({20, 10, 30}, num_samples);
+  ok &= Test({1 - 1e-10, 1 - 1e-10, 1 - 1e-10}, num_samples);
+  ok &= Test({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25},
+             num_samples);
+  ok &= Test({1e-3, 1, 1e3, 1e6}, num_samples);
+  ok &= TestInteger({1, 2, 3}, num_samples);
+  ok &= TestInteger({7, 0, 1}, num_samples);
+  ok &= TestInteger({1, 1, 1, 1}, num_samples);
+  ok &= TestInteger({(uint64_t(1) << 62) - 1, 1, uint64_t(1) << 61},
+                    num_samples);
+  ok &= TestEntropy({1, 1}, 1000000);
+  ok &= TestEntropy({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, 1000000);
+  ok &= TestEntropy({1e-3, 1, 1e3, 1e6}, 1000000);
+  ok &= TestEntropy({1, 1, 1}, 1000000);
+  ok &= TestCertain();
+  ok &= TestDeepWalk();
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
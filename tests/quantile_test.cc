@@ -0,0 +1,138 @@
+// Tests for guide_table_discrete_distribution::quantile().
+//
+// Usage: quantile_test
+
+#include "guide_table_discrete_distribution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "statistics.hpp"
+
+using std::cout;
+using std::endl;
+
+// Reference implementation: binary search over the cumulative distribution.
+std::vector<double> Cdf(const std::vector<double>& weights) {
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  std::vector<double> cdf;
+  double partial = 0.0;
+  for (auto weight : weights) {
+    partial += weight / sum;
+    cdf.push_back(partial);
+  }
+  return cdf;
+}
+
+// Checks that quantile() agrees with binary search over the CDF, is monotone
+// and that the batch version agrees with the scalar version.
+bool TestInversion(const std::vector<double>& weights) {
+  guide_table_discrete_distribution<int> distribution(weights);
+  const std::vector<double> cdf = Cdf(weights);
+  const size_t N = weights.size();
+
+  std::vector<double> uniforms;
+  std::default_random_engine generator(3);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (size_t i = 0; i < 100000; ++i) uniforms.push_back(uniform(generator));
+  // Cell boundaries and their neighbours are where rounding matters.
+  for (size_t j = 0; j <= N; ++j) {
+    const double left = static_cast<double>(j) / N;
+    uniforms.push_back(std::nextafter(left, 0.0));
+    uniforms.push_back(left);
+    uniforms.push_back(std::nextafter(left, 1.0));
+  }
+  // Outcome boundaries.
+  for (const double c : cdf) {
+    uniforms.push_back(std::nextafter(c, 0.0));
+    uniforms.push_back(c);
+  }
+  uniforms.erase(std::remove_if(uniforms.begin(), uniforms.end(),
+                                [](double u) { return u < 0.0 || u > 1.0; }),
+                 uniforms.end());
+  std::sort(uniforms.begin(), uniforms.end());
+
+  std::vector<int> batch(uniforms.size());
+  distribution.quantile(uniforms.data(), uniforms.data() + uniforms.size(),
+                        batch.data());
+
+  bool ok = true;
+  int previous = 0;
+  for (size_t k = 0; k < uniforms.size(); ++k) {
+    const double u = uniforms[k];
+    const int outcome = distribution.quantile(u);
+    const size_t expected = std::min<size_t>(
+      std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), N - 1);
+    // The reference CDF is not patched to end at exactly 1, so it may
+    // disagree just below 1 due to rounding; allow only zero-probability
+    // outcomes to differ there.
+    if (static_cast<size_t>(outcome) != expected
+        && !(u >= cdf[N - 1] - 1e-12)) {
+      ok = false;
+    }
+    ok &= outcome >= previous;
+    ok &= batch[k] == outcome;
+    ok &= weights[outcome] > 0.0;
+    previous = outcome;
+  }
+
+  cout << "TestInversion N=" << N << ": " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// With n stratified points (k + 1/2) / n, every outcome is generated within one
+// of its expected count.
+bool TestStratified(const std::vector<double>& weights, const size_t n) {
+  guide_table_discrete_distribution<int> distribution(weights);
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+  std::vector<size_t> counts(weights.size(), 0);
+  for (size_t k = 0; k < n; ++k)
+    ++counts[distribution.quantile((k + 0.5) / n)];
+
+  bool ok = true;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    const double expected = n * weights[i] / sum;
+    ok &= std::fabs(counts[i] - expected) <= 1.0 + 1e-9 * n;
+  }
+  cout << "TestStratified N=" << weights.size() << ": "
+       << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+// Antithetic pairs u and 1 - u map to outcomes at opposite ends.
+bool TestAntithetic() {
+  guide_table_discrete_distribution<int> distribution({1, 1, 1, 1});
+  const bool ok = distribution.quantile(0.1) == 0
+                  && distribution.quantile(1.0 - 0.1) == 3
+                  && distribution.quantile(0.3) == 1
+                  && distribution.quantile(1.0 - 0.3) == 2;
+  cout << "TestAntithetic: " << (ok ? "OK" : "FAIL") << endl;
+  return ok;
+}
+
+int main() {
+  std::default_random_engine generator(5);
+  std::exponential_distribution<double> exponential(1.0);
+  std::vector<double> random_weights(10007);
+  for (auto& weight : random_weights) weight = exponential(generator);
+  for (size_t i = 0; i < random_weights.size(); i += 3) random_weights[i] = 0.0;
+
+  bool ok = true;
+  ok &= TestInversion({1});
+  ok &= TestInversion({1, 0, 2});
+  ok &= TestInversion({1, 0});
+  ok &= TestInversion({0, 1e-20, 0});
+  ok &= TestInversion({1e-3, 1, 1e3, 1e6});
+  ok &= TestInversion({1e6, 1e3, 1, 1e-3, 0, 0});
+  ok &= TestInversion(random_weights);
+  ok &= TestStratified({1, 2, 3, 4}, 1000000);
+  ok &= TestStratified(random_weights, 1000000);
+  ok &= TestAntithetic();
+
+  cout << (ok ? "All tests passed." : "Some tests FAILED.") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Statistical checks shared by the tests.
+//
+// The checks sample from a distribution in parallel and compare the counts
+// with the exact probabilities, so that any bias introduced by an
+// optimization of the sampling path is caught automatically.
+
+#ifndef TESTS_STATISTICS_HPP_
+#define TESTS_STATISTICS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Regularized upper incomplete gamma function Q(a, x) = Gamma(a, x) / Gamma(a).
+// Uses the power series for x < a + 1 and Lentz's continued fraction
+// otherwise.
+inline double RegularizedGammaQ(const double a, const double x) {
+  if (x <= 0.0) return 1.0;
+  const double log_prefactor = -x + a * std::log(x) - std::lgamma(a);
+
+  if (x < a + 1.0) {
+    double term = 1.0 / a;
+    double sum = term;
+    for (int n = 1; n < 10000; ++n) {
+      term *= x / (a + n);
+      sum += term;
+      if (std::fabs(term) < std::fabs(sum) * 1e-15) break;
+    }
+    return 1.0 - sum * std::exp(log_prefactor);
+  }
+
+  const double tiny = 1e-300;
+  double b = x + 1.0 - a;
+  double c = 1.0 / tiny;
+  double d = 1.0 / b;
+  double h = d;
+  for (int n = 1; n < 10000; ++n) {
+    const double an = -n * (n - a);
+    b += 2.0;
+    d = an * d + b;
+    if (std::fabs(d) < tiny) d = tiny;
+    c = b + an / c;
+    if (std::fabs(c) < tiny) c = tiny;
+    d = 1.0 / d;
+    const double delta = d * c;
+    h *= delta;
+    if (std::fabs(delta - 1.0) < 1e-15) break;
+  }
+  return std::exp(log_prefactor) * h;
+}
+
+// Probability that a chi-squared random variable with the given degrees of
+// freedom exceeds the statistic.
+inline double ChiSquaredPValue(const double statistic, const size_t degrees_of_freedom) {
+  return RegularizedGammaQ(degrees_of_freedom / 2.0, statistic / 2.0);
+}
+
+// Probability that a binomial variable with n trials and success probability
+// p is at least k.  The terms are summed upwards from k, so tails far below 1
+// keep their precision.
+inline double BinomialUpperTail(const size_t n, const double p,
+                                const size_t k) {
+  if (k == 0) return 1.0;
+  if (k > n) return 0.0;
+  if (p >= 1.0) return 1.0;
+  const double log_p = std::log(p);
+  const double log_q = std::log1p(-p);
+  double tail = 0.0;
+  for (size_t j = k; j <= n; ++j) {
+    const double term = std::exp(std::lgamma(n + 1.0) - std::lgamma(j + 1.0)
+                                 - std::lgamma(n - j + 1.0) + j * log_p
+                                 + (n - j) * log_q);
+    tail += term;
+    // Above the mean the terms fall at least geometrically.
+    if (j > n * p && term <= tail * 1e-17) break;
+  }
+  return std::min(tail, 1.0);
+}
+
+// Draws num_samples samples from the distribution and returns the number of
+// times each outcome was generated.  The work is split across hardware
+// threads.  Each thread uses its own copy of the distribution and its own
+// generator seeded deterministically from the thread index.
+template<typename Distribution>
+std::vector<size_t> CountSamples(const Distribution& distribution,
+                                 const size_t num_outcomes,
+                                 const size_t num_samples,
+                                 bool* out_of_range) {
+  const size_t num_threads =
+    std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                         num_samples / 1000000 + 1));
+  std::vector<std::vector<size_t>> thread_counts(
+    num_threads, std::vector<size_t>(num_outcomes, 0));
+  std::vector<char> thread_out_of_range(num_threads, 0);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::default_random_engine generator(static_cast<unsigned>(t + 1));
+      Distribution local_distribution(distribution);
+      const size_t begin = num_samples * t / num_threads;
+      const size_t end = num_samples * (t + 1) / num_threads;
+      std::vector<size_t>& counts = thread_counts[t];
+      for (size_t i = begin; i < end; ++i) {
+        const auto number = local_distribution(generator);
+        if (static_cast<size_t>(number) >= num_outcomes) {
+          thread_out_of_range[t] = 1;
+          continue;
+        }
+        ++counts[number];
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<size_t> counts(num_outcomes, 0);
+  *out_of_range = false;
+  for (size_t t = 0; t < num_threads; ++t) {
+    for (size_t i = 0; i < num_outcomes; ++i) counts[i] += thread_counts[t][i];
+    if (thread_out_of_range[t]) *out_of_range = true;
+  }
+  return counts;
+}
+
+// Significance level used by all statistical tests.  The tests are
+// deterministic (fixed seeds), so the level only guards against a biased
+// sampler passing by accident.
+static const double kSignificanceLevel = 1e-6;
+
+// Number of standard deviations an individual outcome count may deviate from
+// its expectation.
+static const double kMaxZScore = 6.0;
+
+// Outcomes with a smaller expected count are rare: the chi-squared
+// approximation does not hold for them, so they are pooled into one cell of
+// the chi-squared and G statistics, and that cell is dropped if its expected
+// count is below this as well.  Each rare outcome is checked with the exact
+// binomial tail instead.
+static const double kMinExpectedCount = 5.0;
+
+// Samples from the distribution and checks the observed counts against the
+// exact probabilities given by the weights using Pearson's chi-squared test,
+// the G-test, a per-outcome binomial z-score check, an exact binomial tail for
+// rare outcomes and the Kolmogorov-Smirnov statistic of the cumulative
+// counts.  Returns true if all checks pass.
+template<typename Distribution>
+bool CheckGoodnessOfFit(const std::string& name,
+                        const Distribution& distribution,
+                        const std::vector<double>& weights,
+                        const size_t num_samples) {
+  const size_t N = weights.size();
+  bool out_of_range;
+  const std::vector<size_t> counts =
+    CountSamples(distribution, std::max<size_t>(N, 1), num_samples,
+                 &out_of_range);
+
+  std::cout << name << " N=" << N << " samples=" << num_samples << ": ";
+  if (out_of_range) {
+    std::cout << "FAIL (sample out of range)" << std::endl;
+    return false;
+  }
+
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  if (N == 0 || !(sum > 0.0)) {
+    // No well-defined distribution; any sample in range is acceptable.
+    std::cout << "OK (degenerate)" << std::endl;
+    return true;
+  }
+
+  const double n = static_cast<double>(num_samples);
+  double chi_squared = 0.0;
+  double g_statistic = 0.0;
+  double max_z_score = 0.0;
+  double ks_statistic = 0.0;
+  double expected_cdf = 0.0;
+  double observed_cdf = 0.0;
+  size_t num_cells = 0;
+  double rare_observed = 0.0;
+  double rare_expected = 0.0;
+  double min_rare_tail = 1.0;
+  bool zero_probability_sampled = false;
+
+  auto add_cell = [&](const double observed, const double expected) {
+    ++num_cells;
+    chi_squared += (observed - expected) * (observed - expected) / expected;
+    if (observed > 0.0)
+      g_statistic += 2.0 * observed * std::log(observed / expected);
+  };
+
+  for (size_t i = 0; i < N; ++i) {
+    const double p = weights[i] / sum;
+    const double observed = static_cast<double>(counts[i]);
+    const double expected = n * p;
+
+    expected_cdf += p;
+    observed_cdf += observed / n;
+    ks_statistic = std::max(ks_statistic, std::fabs(observed_cdf - expected_cdf));
+
+    if (p <= 0.0) {
+      if (counts[i] > 0) zero_probability_sampled = true;
+      continue;
+    }
+
+    if (expected < kMinExpectedCount) {
+      rare_observed += observed;
+      rare_expected += expected;
+      min_rare_tail = std::min(min_rare_tail,
+                               BinomialUpperTail(num_samples, p, counts[i]));
+      continue;
+    }
+    add_cell(observed, expected);
+
+    const double variance = n * p * (1.0 - p);
+    if (variance > 0.0) {
+      max_z_score = std::max(max_z_score,
+                             std::fabs(observed - expected) / std::sqrt(variance));
+    }
+  }
+
+  if (rare_expected >= kMinExpectedCount)
+    add_cell(rare_observed, rare_expected);
+
+  const size_t degrees_of_freedom = num_cells > 0 ? num_cells - 1 : 0;
+  const double chi_squared_p_value = degrees_of_freedom > 0
+    ? ChiSquaredPValue(chi_squared, degrees_of_freedom) : 1.0;
+  const double g_p_value = degrees_of_freedom > 0
+    ? ChiSquaredPValue(g_statistic, degrees_of_freedom) : 1.0;
+  // Asymptotic Kolmogorov critical value.  It is conservative for discrete
+  // distributions.
+  const double ks_critical =
+    std::sqrt(-0.5 * std::log(kSignificanceLevel / 2.0) / n);
+
+  const bool ok = !zero_probability_sampled
+                  && chi_squared_p_value >= kSignificanceLevel
+                  && g_p_value >= kSignificanceLevel
+                  && max_z_score <= kMaxZScore
+                  && min_rare_tail >= kSignificanceLevel
+                  && ks_statistic <= ks_critical;
+
+  std::cout << (ok ? "OK" : "FAIL")
+            << " (chi2 p=" << chi_squared_p_value
+            << ", G p=" << g_p_value
+            << ", max |z|=" << max_z_score
+            << ", rare tail p=" << min_rare_tail
+            << ", KS=" << ks_statistic << "/" << ks_critical
+            << (zero_probability_sampled ? ", zero-probability outcome sampled" : "")
+            << ")" << std::endl;
+  return ok;
+}
+
+// Weights drawn from the exponential distribution, the same for the same N.
+inline std::vector<double> RandomWeights(const size_t N) {
+  std::default_random_engine generator(static_cast<unsigned>(N));
+  std::exponential_distribution<double> exponential(1.0);
+  std::vector<double> weights(N);
+  for (auto& weight : weights) weight = exponential(generator);
+  return weights;
+}
+
+// Checks that generate() of a copy of the distribution returns the same
+// samples as repeated calls of operator() on another copy, given generators
+// in the same state.  An odd count exercises the scalar tails of the vector
+// kernels.
+template<typename Distribution>
+bool CheckGenerateMatchesSampling(const std::string& name,
+                                  const Distribution& distribution) {
+  typedef typename Distribution::result_type result_type;
+  Distribution scalar_distribution(distribution);
+  Distribution bulk_distribution(distribution);
+  std::default_random_engine scalar_generator(7);
+  std::default_random_engine bulk_generator(7);
+  std::vector<result_type> samples(10007);
+  bulk_distribution.generate(bulk_generator, samples.data(),
+                             samples.data() + samples.size());
+  bool ok = true;
+  for (const result_type sample : samples)
+    ok &= sample == scalar_distribution(scalar_generator);
+  std::cout << name << ": " << (ok ? "OK" : "FAIL") << std::endl;
+  return ok;
+}
+
+#endif  // TESTS_STATISTICS_HPP_